@@ -18,6 +18,8 @@
 #include "tapi/tapi.h"
 #include "tapi/Core/LLVM.h"
 #include "tapi/PackedVersion32.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
@@ -34,54 +36,58 @@ enum Arch : uint32_t {
   x86_64h = 1U << 6,
 };
 
+/// \brief A set of architectures stored as a bit mask.
+///
+/// All operations are constexpr. Counting and iteration use the population
+/// count and count trailing zeros instructions instead of testing every bit.
 class ArchitectureSet {
 private:
   typedef uint32_t ArchSetType;
 
-  const static ArchSetType _endIndexVal =
-      std::numeric_limits<ArchSetType>::max();
   ArchSetType _archSet;
 
 public:
-  ArchitectureSet() : _archSet(Arch::unknown) {}
-  ArchitectureSet(ArchSetType raw) : _archSet(raw) {}
-
-  void set(Arch arch) { _archSet |= (ArchSetType)arch; }
-  bool has(Arch arch) const { return _archSet & arch; }
-
-  size_t count() const {
-    // popcnt
-    size_t cnt = 0;
-    for (unsigned i = 0; i < sizeof(ArchSetType) * 8; ++i)
-      if (_archSet & (1U << i))
-        ++cnt;
-    return cnt;
-  }
+  constexpr ArchitectureSet() : _archSet(Arch::unknown) {}
+  constexpr ArchitectureSet(ArchSetType raw) : _archSet(raw) {}
+
+  constexpr explicit operator ArchSetType() const { return _archSet; }
+
+  constexpr void set(Arch arch) { _archSet |= (ArchSetType)arch; }
+  constexpr void clear(Arch arch) { _archSet &= ~(ArchSetType)arch; }
+  constexpr bool has(Arch arch) const { return _archSet & arch; }
 
-  bool empty() const { return _archSet == 0; }
+  constexpr size_t count() const { return __builtin_popcount(_archSet); }
 
-  bool hasX86() const { return _archSet & (i386 | x86_64 | x86_64h); }
+  constexpr bool empty() const { return _archSet == 0; }
 
-  bool hasABICompatibleSlice(Arch arch) const {
+  constexpr bool hasX86() const { return _archSet & (i386 | x86_64 | x86_64h); }
+
+  /// \brief The architectures that can be linked against the architecture.
+  static constexpr ArchSetType getABICompatibleArchs(Arch arch) {
     switch (arch) {
     case unknown:
-      return false;
+      return 0;
     case armv7:
     case armv7s:
-      return has(armv7) || has(armv7s);
+      return armv7 | armv7s;
     case armv7k:
-      return has(armv7k);
+      return armv7k;
     case arm64:
-      return has(arm64);
+      return arm64;
     case i386:
-      return has(i386);
+      return i386;
     case x86_64:
     case x86_64h:
-      return has(x86_64) || has(x86_64h);
+      return x86_64 | x86_64h;
     }
+    return 0;
+  }
+
+  constexpr bool hasABICompatibleSlice(Arch arch) const {
+    return _archSet & getABICompatibleArchs(arch);
   }
 
-  Arch getABICompatibleSlice(Arch arch) const {
+  constexpr Arch getABICompatibleSlice(Arch arch) const {
     switch (arch) {
     case unknown:
       return unknown;
@@ -111,120 +117,157 @@ public:
         return x86_64h;
       return unknown;
     }
+    return unknown;
   }
 
-  template <typename Ty>
+  /// \brief Iterates over the architectures of the set in ascending order.
+  ///
+  /// The iterator holds the architectures that remain to be visited and
+  /// removes the lowest one on every step.
   class arch_iterator
       : public std::iterator<std::forward_iterator_tag, Arch, size_t> {
   private:
-    ArchSetType _index;
-    Ty *_archSet;
-
-    void findNextSetBit() {
-      if (_index == _endIndexVal)
-        return;
-
-      do {
-        if (*_archSet & (1UL << ++_index))
-          return;
-      } while (_index < sizeof(Ty) * 8);
-
-      _index = _endIndexVal;
-    }
+    ArchSetType _remaining;
 
   public:
-    arch_iterator(Ty *archSet, ArchSetType index = 0)
-        : _index(index), _archSet(archSet) {
-      if (index != _endIndexVal && !(*_archSet & (1UL << index)))
-        findNextSetBit();
-    }
+    constexpr explicit arch_iterator(ArchSetType remaining)
+        : _remaining(remaining) {}
 
-    Arch operator*() const { return (Arch)(1U << _index); }
+    constexpr Arch operator*() const {
+      return (Arch)(_remaining & -_remaining);
+    }
 
-    arch_iterator &operator++() {
-      findNextSetBit();
+    constexpr arch_iterator &operator++() {
+      _remaining &= _remaining - 1;
       return *this;
     }
 
-    arch_iterator operator++(int) {
+    constexpr arch_iterator operator++(int) {
       auto tmp = *this;
-      findNextSetBit();
+      ++*this;
       return tmp;
     }
 
-    bool operator==(const arch_iterator &o) const {
-      return std::tie(_index, _archSet) == std::tie(o._index, o._archSet);
+    constexpr bool operator==(const arch_iterator &o) const {
+      return _remaining == o._remaining;
     }
 
-    bool operator!=(const arch_iterator &o) const { return !(*this == o); }
+    constexpr bool operator!=(const arch_iterator &o) const {
+      return !(*this == o);
+    }
   };
 
-  ArchitectureSet operator&(const ArchitectureSet &o) {
+  constexpr ArchitectureSet operator&(const ArchitectureSet &o) const {
     return _archSet & o._archSet;
   }
 
-  ArchitectureSet operator|(const ArchitectureSet &o) {
+  constexpr ArchitectureSet operator|(const ArchitectureSet &o) const {
     return _archSet | o._archSet;
   }
 
-  ArchitectureSet &operator|=(const ArchitectureSet &o) {
+  constexpr ArchitectureSet &operator|=(const ArchitectureSet &o) {
     _archSet |= o._archSet;
     return *this;
   }
 
-  bool operator==(const ArchitectureSet &o) const {
+  constexpr bool operator==(const ArchitectureSet &o) const {
     return _archSet == o._archSet;
   }
 
-  bool operator!=(const ArchitectureSet &o) const {
+  constexpr bool operator!=(const ArchitectureSet &o) const {
     return _archSet != o._archSet;
   }
 
-  bool operator<(const ArchitectureSet &o) const {
+  constexpr bool operator<(const ArchitectureSet &o) const {
     return _archSet < o._archSet;
   }
 
-  typedef arch_iterator<ArchSetType> iterator;
-  typedef arch_iterator<const ArchSetType> const_iterator;
+  typedef arch_iterator iterator;
+  typedef arch_iterator const_iterator;
 
-  iterator begin() { return iterator(&_archSet); }
-  iterator end() { return iterator(&_archSet, _endIndexVal); }
+  constexpr const_iterator begin() const { return const_iterator(_archSet); }
+  constexpr const_iterator end() const { return const_iterator(0); }
+};
+
+/// \brief The numeric components of a dot separated version string.
+struct VersionComponents {
+  static constexpr unsigned maxCount = 5;
+
+  /// \brief The value of a component that isn't a decimal number or doesn't
+  /// fit into 64 bits. It is larger than any valid component.
+  static constexpr uint64_t invalid = UINT64_MAX;
+
+  /// The first maxCount components.
+  uint64_t values[maxCount] = {};
 
-  const_iterator begin() const { return const_iterator(&_archSet); }
-  const_iterator end() const { return const_iterator(&_archSet, _endIndexVal); }
+  /// The number of components, which can be larger than maxCount.
+  unsigned count = 0;
 };
 
+/// \brief Split a version string into its components without allocating.
+///
+/// Empty components are skipped, so "10..9" has the two components 10 and 9.
+/// Callers check the number of components and the range of each value.
+constexpr VersionComponents splitVersion(const char *begin, const char *end) {
+  VersionComponents result;
+  for (auto *it = begin; it != end;) {
+    if (*it == '.') {
+      ++it;
+      continue;
+    }
+
+    uint64_t value = 0;
+    for (; it != end && *it != '.'; ++it) {
+      unsigned digit = *it - '0';
+      if (value == VersionComponents::invalid || digit > 9 ||
+          value > (UINT64_MAX - digit) / 10)
+        value = VersionComponents::invalid;
+      else
+        value = value * 10 + digit;
+    }
+
+    if (result.count < VersionComponents::maxCount)
+      result.values[result.count] = value;
+    ++result.count;
+  }
+  return result;
+}
+
+inline VersionComponents splitVersion(StringRef str) {
+  return splitVersion(str.begin(), str.end());
+}
+
 struct PackedVersion {
   uint32_t _version;
 
-  PackedVersion() : _version(0) {}
-  PackedVersion(uint32_t version) : _version(version) {}
-  PackedVersion(unsigned major, unsigned minor, unsigned subminor)
+  constexpr PackedVersion() : _version(0) {}
+  constexpr PackedVersion(uint32_t version) : _version(version) {}
+  constexpr PackedVersion(unsigned major, unsigned minor, unsigned subminor)
       : _version((major << 16) | ((minor & 0xff) << 8) | (subminor & 0xff)) {}
 
-  bool empty() const { return _version == 0; }
+  constexpr bool empty() const { return _version == 0; }
 
   /// \brief Retrieve the major version number.
-  unsigned getMajor() const { return _version >> 16; }
+  constexpr unsigned getMajor() const { return _version >> 16; }
 
   /// \brief Retrieve the minor version number, if provided.
-  unsigned getMinor() const { return (_version >> 8) & 0xff; }
+  constexpr unsigned getMinor() const { return (_version >> 8) & 0xff; }
 
   /// \brief Retrieve the subminor version number, if provided.
-  unsigned getSubminor() const { return _version & 0xff; }
+  constexpr unsigned getSubminor() const { return _version & 0xff; }
 
   bool parse32(StringRef str);
   std::pair<bool, bool> parse64(StringRef str);
 
-  bool operator<(const PackedVersion &rhs) const {
+  constexpr bool operator<(const PackedVersion &rhs) const {
     return _version < rhs._version;
   }
 
-  bool operator==(const PackedVersion &rhs) const {
+  constexpr bool operator==(const PackedVersion &rhs) const {
     return _version == rhs._version;
   }
 
-  bool operator!=(const PackedVersion &rhs) const {
+  constexpr bool operator!=(const PackedVersion &rhs) const {
     return _version != rhs._version;
   }
 
@@ -0,0 +1,153 @@
+//===- tapi/Core/CompiledStub.h - TAPI Compiled Stub ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the reader and writer for compiled stub files.
+///
+/// A compiled stub is a versioned binary image of an interface file. All
+/// references are offsets from the start of the image and the symbol tables are
+/// sorted, so the image can be memory mapped and read without tokenizing or
+/// sorting. Reading validates the image and copies its names into the string
+/// pool of a new interface file. A compiled stub can record the hash and size
+/// of the text-based stub file it was compiled from, which allows it to be used
+/// in place of that file.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_COMPILED_STUB_H
+#define TAPI_CORE_COMPILED_STUB_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Core/Registry.h"
+#include "tapi/Defines.h"
+#include "llvm/Support/Endian.h"
+#include <string>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+class ExportFilter;
+class InterfaceFile;
+
+namespace compiled {
+
+using llvm::support::ulittle32_t;
+using llvm::support::ulittle64_t;
+
+static const char Magic[8] = {'T', 'A', 'P', 'I', 'S', 'T', 'U', 'B'};
+static const uint32_t CurrentVersion = 3;
+
+/// \brief A string in the string table.
+struct String {
+  ulittle32_t offset;
+  ulittle32_t size;
+};
+
+/// \brief An array of entries.
+struct Table {
+  ulittle32_t offset;
+  ulittle32_t count;
+};
+
+enum HeaderFlags : uint32_t {
+  TwoLevelNamespace = 1U << 0,
+  ApplicationExtensionSafe = 1U << 1,
+};
+
+struct Header {
+  char magic[8];
+  ulittle32_t version;
+  ulittle32_t sourceFileType;
+  ulittle64_t sourceHash;
+  ulittle64_t sourceSize;
+  ulittle32_t platform;
+  ulittle32_t architectures;
+  ulittle32_t currentVersion;
+  ulittle32_t compatibilityVersion;
+  ulittle32_t swiftVersion;
+  ulittle32_t objcConstraint;
+  ulittle32_t flags;
+  String installName;
+  String parentUmbrella;
+  Table uuids;
+  Table allowableClients;
+  Table reexportedLibraries;
+  Table exports;
+  Table undefineds;
+  Table exportFilter;
+  ulittle32_t stringTableOffset;
+  ulittle32_t stringTableSize;
+};
+
+/// \brief The UUID of an architecture, stored as its raw bytes.
+struct UUID {
+  ulittle32_t arch;
+  uint8_t value[16];
+};
+
+struct Library {
+  String installName;
+  ulittle32_t architectures;
+};
+
+/// \brief A symbol. The symbols are sorted by name and type.
+struct Symbol {
+  String name;
+  ulittle32_t architectures;
+  uint8_t type;
+  uint8_t flags;
+  uint8_t reserved[2];
+};
+
+/// \brief The export filter is stored as an array of little endian words.
+using FilterWord = ulittle64_t;
+
+} // end namespace compiled.
+
+class CompiledStubReader final : public Reader {
+public:
+  bool canRead(file_magic magic, MemoryBufferRef bufferRef,
+               FileType types) const override;
+  FileType getFileType(file_magic magic,
+                       MemoryBufferRef bufferRef) const override;
+  std::unique_ptr<File> readFile(MemoryBufferRef memBuffer,
+                                 ReadFlags readFlags,
+                                 SkipFlags skipFlags) const override;
+
+  /// \brief Check if the image is a compiled stub of the source file with the
+  /// given content hash and size.
+  static bool isCompiledFrom(MemoryBufferRef bufferRef, uint64_t sourceHash,
+                             uint64_t sourceSize);
+
+  /// \brief Read the export filter of the image.
+  ///
+  /// \returns an empty filter if the image has none or is malformed.
+  static ExportFilter readExportFilter(MemoryBufferRef bufferRef);
+};
+
+class CompiledStubWriter final : public Writer {
+public:
+  bool canWrite(const File *file) const override;
+  std::error_code writeFile(const File *file) const override;
+  std::error_code writeFile(raw_ostream &os, const File *file) const override;
+
+  /// \brief Serialize the interface file.
+  ///
+  /// The source hash and size identify the text-based stub file the interface
+  /// file was read from. A source hash of zero means there is no such file.
+  static void write(raw_ostream &os, const InterfaceFile &file,
+                    uint64_t sourceHash = 0, uint64_t sourceSize = 0);
+};
+
+/// \brief Return the path of the compiled stub that belongs to the text-based
+/// stub file.
+std::string getCompiledStubPath(StringRef path);
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_COMPILED_STUB_H
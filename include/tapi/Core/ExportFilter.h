@@ -0,0 +1,60 @@
+//===- tapi/Core/ExportFilter.h - Exported Symbol Filter --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief A Bloom filter over the exported symbol names of a file.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_EXPORT_FILTER_H
+#define TAPI_CORE_EXPORT_FILTER_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <vector>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+class SymbolSet;
+
+/// \brief A Bloom filter over the names of a symbol set.
+///
+/// The filter answers if a name may be in the set. It never reports a name of
+/// the set as missing, and reports about one percent of the other names as
+/// present. The filter only depends on the names, so it can be stored in a
+/// compiled stub file and reused by other processes.
+///
+/// A default constructed filter has no information and reports every name as
+/// present.
+class ExportFilter {
+public:
+  ExportFilter() = default;
+
+  /// \brief Create the filter for the names of the symbols.
+  static ExportFilter create(const SymbolSet &symbols);
+
+  /// \brief Recreate a filter from the words of another filter.
+  static ExportFilter createFromWords(std::vector<uint64_t> words);
+
+  bool empty() const { return _words.empty(); }
+  llvm::ArrayRef<uint64_t> getWords() const { return _words; }
+
+  /// \brief Return false if the name is definitely not in the set.
+  bool mayContain(StringRef name) const;
+
+private:
+  std::vector<uint64_t> _words;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_EXPORT_FILTER_H
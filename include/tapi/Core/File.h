@@ -37,6 +37,9 @@ enum FileType : unsigned {
   /// \brief Text-based stub file (.tbd) version 2.0
   TBD_V2                    = 1U << 3,
 
+  /// \brief Compiled stub file (.tbdc)
+  CompiledStub              = 1U << 4,
+
   All                       = ~0U,
 };
 
@@ -0,0 +1,69 @@
+//===- tapi/Core/Fingerprint.h - TAPI Fingerprint ---------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines a 128-bit fingerprint of unordered content.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_FINGERPRINT_H
+#define TAPI_CORE_FINGERPRINT_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <string>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief A 128-bit fingerprint made of two independently hashed lanes.
+///
+/// The fingerprint of a set is the sum of the fingerprints of its entries, so
+/// it doesn't depend on the order in which the entries are added, and entries
+/// can be subtracted again. The hashes don't depend on the host, so
+/// fingerprints can be stored and compared across processes.
+struct Fingerprint {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  /// \brief Hash the name of an entry.
+  static Fingerprint get(StringRef name);
+
+  /// \brief Combine the hash of a name with the attributes of the entry.
+  Fingerprint withAttributes(uint64_t attributes) const;
+
+  /// \brief Mix the lanes into the final fingerprint of a set.
+  Fingerprint finalize() const;
+
+  Fingerprint &operator+=(const Fingerprint &rhs) {
+    low += rhs.low;
+    high += rhs.high;
+    return *this;
+  }
+
+  Fingerprint &operator-=(const Fingerprint &rhs) {
+    low -= rhs.low;
+    high -= rhs.high;
+    return *this;
+  }
+
+  bool operator==(const Fingerprint &rhs) const {
+    return low == rhs.low && high == rhs.high;
+  }
+
+  bool operator!=(const Fingerprint &rhs) const { return !(*this == rhs); }
+
+  /// \brief The fingerprint as 32 hexadecimal digits, high lane first.
+  std::string str() const;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_FINGERPRINT_H
@@ -0,0 +1,146 @@
+//===- tapi/Core/Instrumentation.h - Hot Path Instrumentation ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Process-wide timings and counters of the hot paths.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_INSTRUMENTATION_H
+#define TAPI_CORE_INSTRUMENTATION_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/StringRef.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief Collects timings and counters of the hot paths.
+///
+/// Collection is off by default and costs a single relaxed load per
+/// instrumented scope. It is enabled programmatically or by setting the
+/// environment variable TAPI_STATISTICS. Setting TAPI_TRACE additionally
+/// prints one line per created linker interface file and a summary at exit to
+/// the standard error stream. The environment is read by #initialize, which
+/// the library calls before it reads the first file.
+///
+/// Phases may nest, e.g. the parse time includes the denormalize time.
+class Instrumentation {
+public:
+  enum class Phase : unsigned {
+    Copy,
+    Parse,
+    Denormalize,
+    Projection,
+    Sort,
+    LinkerDirectives,
+    ReadBinary,
+  };
+  static constexpr unsigned NumPhases = 7;
+
+  enum class Counter : unsigned {
+    FilesCreated,
+    TextFilesRead,
+    BinaryFilesRead,
+    BytesRead,
+    SymbolsRead,
+  };
+  static constexpr unsigned NumCounters = 5;
+
+  static void initialize();
+
+  static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled);
+
+  static void addTime(Phase phase, uint64_t nanoseconds);
+  static void add(Counter counter, uint64_t value);
+
+  static uint64_t getTime(Phase phase);
+  static uint64_t get(Counter counter);
+  static void reset();
+
+  static StringRef getName(Phase phase);
+  static StringRef getName(Counter counter);
+
+  /// \brief Adds the time spent in its scope to the phase.
+  class Timer {
+  public:
+    explicit Timer(Phase phase) : _phase(phase), _active(isEnabled()) {
+      if (_active)
+        _start = std::chrono::steady_clock::now();
+    }
+
+    ~Timer() {
+      if (!_active)
+        return;
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - _start);
+      addTime(_phase, elapsed.count());
+    }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+  private:
+    Phase _phase;
+    bool _active;
+    std::chrono::steady_clock::time_point _start;
+  };
+
+  /// \brief The timings and counters attributed to a trace.
+  struct TraceRecord;
+
+  /// \brief Attributes the timings and counters recorded within its scope to
+  /// the file and prints them when tracing.
+  ///
+  /// This covers the current thread and the threads that adopt the trace with
+  /// a TraceScope. A trace nested in another one records into the outer trace.
+  class Trace {
+  public:
+    explicit Trace(StringRef path);
+    ~Trace();
+
+    Trace(const Trace &) = delete;
+    Trace &operator=(const Trace &) = delete;
+
+  private:
+    StringRef _path;
+    std::unique_ptr<TraceRecord> _record;
+  };
+
+  /// \brief Return the trace the current thread records into, or nullptr.
+  static TraceRecord *getCurrentTrace();
+
+  /// \brief Makes the current thread record into the trace within its scope.
+  ///
+  /// Work that a traced thread hands off to other threads, such as the workers
+  /// of parallelFor, uses this to stay attributed to the trace.
+  class TraceScope {
+  public:
+    explicit TraceScope(TraceRecord *record);
+    ~TraceScope();
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    TraceRecord *_previous;
+  };
+
+private:
+  static std::atomic<bool> _enabled;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_INSTRUMENTATION_H
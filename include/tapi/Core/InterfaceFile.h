@@ -19,10 +19,15 @@
 
 #include "tapi/Core/ArchitectureSupport.h"
 #include "tapi/Core/File.h"
+#include "tapi/Core/Fingerprint.h"
 #include "tapi/Core/STLExtras.h"
+#include "tapi/Core/StringPool.h"
 #include "tapi/Core/Symbol.h"
+#include "tapi/Core/SymbolSet.h"
+#include "tapi/Core/UUID.h"
 #include "tapi/Defines.h"
 #include "llvm/Support/YAMLTraits.h"
+#include <cassert>
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
@@ -30,19 +35,21 @@ using TAPI_INTERNAL::Symbol;
 
 class InterfaceFile;
 
+/// \brief A reference to another library by install name.
+///
+/// The install name has to be interned in the string pool of the file that
+/// holds the reference, because the same few libraries are referenced by many
+/// files.
 class InterfaceFileRef {
 public:
   InterfaceFileRef() = default;
 
-  template <typename T>
-  InterfaceFileRef(T &&installName)
-      : _installName(std::forward<T &&>(installName)) {}
+  InterfaceFileRef(StringRef installName) : _installName(installName) {}
 
-  template <typename T>
-  InterfaceFileRef(T &&installName, ArchitectureSet archs)
-      : _installName(std::forward<T &&>(installName)), _architectures(archs) {}
+  InterfaceFileRef(StringRef installName, ArchitectureSet archs)
+      : _installName(installName), _architectures(archs) {}
 
-  const std::string &getInstallName() const { return _installName; };
+  StringRef getInstallName() const { return _installName; };
   void setArchitectures(ArchitectureSet archs) { _architectures |= archs; }
   ArchitectureSet getArchitectures() const { return _architectures; }
   bool hasArchitecture(Arch arch) const { return _architectures.has(arch); }
@@ -51,9 +58,11 @@ public:
   void setInterfaceFile(const InterfaceFile *file) { _file = file; }
   const InterfaceFile *getInterfaceFile() const { return _file; }
 
+  /// The references might belong to files of different sessions, so the
+  /// install names are compared by value.
   bool operator==(const InterfaceFileRef &o) const {
-    return std::tie(_installName, _architectures) ==
-           std::tie(o._installName, o._architectures);
+    return _installName == o._installName &&
+           _architectures == o._architectures;
   }
 
   bool operator<(const InterfaceFileRef &o) const {
@@ -62,7 +71,7 @@ public:
   }
 
   // FIXME: Make this temporary public.
-  std::string _installName;
+  StringRef _installName;
 
 private:
   ArchitectureSet _architectures;
@@ -75,16 +84,28 @@ enum class SearchMode {
   Private,
 };
 
+/// \brief The interface of a dynamic library.
+///
+/// A file is populated by one thread, usually a reader, and then frozen. A
+/// frozen file must not be modified anymore. None of the const methods modify
+/// the file, not even lazily, so a frozen file can be read by any number of
+/// threads concurrently without synchronization. Frozen files are shared
+/// between threads through the reference counted ParsedInterfaceFile.
+///
+/// All names of the file are interned in the string pool of the session the
+/// file was created in. The file keeps the pool alive.
 class InterfaceFile : public File {
 public:
   static bool classof(const File *file) {
     return file->kind() == File::Kind::InterfaceFile;
   }
 
-  using SymbolMap = std::map<std::pair<std::string, SymbolType>, Symbol>;
+  InterfaceFile()
+      : File(File::Kind::InterfaceFile), _pool(StringPool::getSession()),
+        _exports(*_pool), _undefineds(*_pool) {}
+  virtual ~InterfaceFile();
 
-  InterfaceFile() : File(File::Kind::InterfaceFile) {}
-  virtual ~InterfaceFile() = default;
+  StringPool &getStringPool() const { return *_pool; }
 
   void setPlatform(Platform platform) { _platform = platform; }
   Platform getPlatform() const { return _platform; }
@@ -94,10 +115,10 @@ public:
   ArchitectureSet getArchitectures() const { return _architectures; }
   void clearArchitectures() { _architectures = Arch::unknown; }
 
-  template <typename T> void setInstallName(T &&installName) {
-    _installName = std::forward<T &&>(installName);
+  void setInstallName(StringRef installName) {
+    _installName = _pool->intern(installName);
   }
-  const std::string &getInstallName() const { return _installName; }
+  StringRef getInstallName() const { return _installName; }
 
   void setCurrentVersion(PackedVersion version) { _currentVersion = version; }
   PackedVersion getCurrentVersion() const { return _currentVersion; }
@@ -123,23 +144,23 @@ public:
   }
   ObjCConstraint getObjCConstraint() const { return _objcConstraint; }
 
-  template <typename T> void setParentUmbrella(T &&parent) {
-    _parentUmbrella = std::forward<T &&>(parent);
+  void setParentUmbrella(StringRef parent) {
+    _parentUmbrella = _pool->intern(parent);
   }
-  const std::string &getParentUmbrella() const { return _parentUmbrella; }
+  StringRef getParentUmbrella() const { return _parentUmbrella; }
 
-  template <typename T>
-  void addAllowableClient(T &&installName, ArchitectureSet archs) {
-    auto client = addEntry(_allowableClients, std::forward<T &&>(installName));
+  void addAllowableClient(StringRef installName, ArchitectureSet archs) {
+    assertMutable();
+    auto client = addEntry(_allowableClients, installName);
     client->setArchitectures(archs);
   }
   const std::vector<InterfaceFileRef> &allowableClients() const {
     return _allowableClients;
   }
 
-  template <typename T>
-  void addReexportedLibrary(T &&installName, ArchitectureSet archs) {
-    auto lib = addEntry(_reexportedLibraries, std::forward<T &&>(installName));
+  void addReexportedLibrary(StringRef installName, ArchitectureSet archs) {
+    assertMutable();
+    auto lib = addEntry(_reexportedLibraries, installName);
     lib->setArchitectures(archs);
   }
 
@@ -148,108 +169,146 @@ public:
   const std::vector<InterfaceFileRef> &reexportedLibraries() const {
     return _reexportedLibraries;
   }
+  std::vector<InterfaceFileRef> &reexportedLibraries() {
+    assertMutable();
+    return _reexportedLibraries;
+  }
 
-  template <typename T>
-  void addExportedSymbol(T &&name, SymbolType type, SymbolFlags flags,
+  void addExportedSymbol(StringRef name, SymbolType type, SymbolFlags flags,
                          ArchitectureSet archs);
-  bool removeExportedSymbol(const std::string &name, SymbolType type);
-  bool removeExportedSymbol(const std::string &name, SymbolType type,
+  bool removeExportedSymbol(StringRef name, SymbolType type);
+  bool removeExportedSymbol(StringRef name, SymbolType type,
                             ArchitectureSet archs);
-  const SymbolMap &exports() const { return _exports; }
+  const SymbolSet &exports() const { return _exports; }
 
-  template <typename T>
-  void addUndefinedSymbol(T &&name, SymbolType type, SymbolFlags flags,
+  void addUndefinedSymbol(StringRef name, SymbolType type, SymbolFlags flags,
                           ArchitectureSet archs);
-  const SymbolMap &undefineds() const { return _undefineds; }
+  const SymbolSet &undefineds() const { return _undefineds; }
+
+  /// \brief Append symbols in the order of a finalized file, which is cheaper
+  /// than adding them in any order.
+  ///
+  /// \returns false if the symbol doesn't sort after the last symbol.
+  bool appendExportedSymbol(StringRef name, SymbolType type, SymbolFlags flags,
+                            ArchitectureSet archs) {
+    assertMutable();
+    return _exports.append(name, type, flags, archs);
+  }
+  bool appendUndefinedSymbol(StringRef name, SymbolType type,
+                             SymbolFlags flags, ArchitectureSet archs) {
+    assertMutable();
+    return _undefineds.append(name, type, flags, archs);
+  }
+  void reserveSymbols(size_t numExports, size_t numUndefineds) {
+    _exports.reserve(numExports);
+    _undefineds.reserve(numUndefineds);
+  }
 
-  template <typename T> void addUUID(Arch arch, T &&uuid) {
-    auto it = find_if(_uuids, [arch](std::pair<Arch, std::string> &u) {
+  void addUUID(Arch arch, const UUID &uuid) {
+    auto it = find_if(_uuids, [arch](std::pair<Arch, UUID> &u) {
       return u.first == arch;
     });
     if (it == _uuids.end()) {
       auto insertAt =
-          lower_bound(_uuids, arch, [](const std::pair<Arch, std::string> &lhs,
+          lower_bound(_uuids, arch, [](const std::pair<Arch, UUID> &lhs,
                                        Arch rhs) { return lhs.first < rhs; });
 
-      _uuids.emplace(insertAt, arch, std::forward<T &&>(uuid));
+      _uuids.emplace(insertAt, arch, uuid);
       return;
     }
 
-    it->second = std::forward<T &&>(uuid);
+    it->second = uuid;
   }
-  void addUUID(uint8_t uuid[16], Arch arch);
-  const std::vector<std::pair<Arch, std::string>> &uuids() const {
-    return _uuids;
+  void addUUID(const uint8_t uuid[16], Arch arch) {
+    addUUID(arch, UUID(uuid));
   }
+  const std::vector<std::pair<Arch, UUID>> &uuids() const { return _uuids; }
   void clearUUIDs() { _uuids.clear(); }
 
+  /// \brief The fingerprint of the interface the library presents to the
+  /// linker.
+  ///
+  /// The fingerprint covers the install name, the current and compatibility
+  /// version, and the exported symbols and reexported libraries of every
+  /// architecture. It doesn't depend on the file format, so a dynamic library
+  /// and the text-based stub file generated from it have the same
+  /// fingerprint.
+  Fingerprint getFingerprint() const;
+
+  /// \brief A digest of the symbols and libraries of the file.
+  ///
+  /// The digest covers the exported and undefined symbols, the reexported
+  /// libraries and the allowable clients. It doesn't depend on the order in
+  /// which they were added and is stable across processes.
+  uint64_t getContentDigest() const;
+
   bool contains(const Symbol &symbol, Symbol &result) const;
   bool contains(const Symbol &symbol) const {
     Symbol result;
     return contains(symbol, result);
   }
 
+  /// \brief Compact the symbol tables once the file has been populated.
+  ///
+  /// This is called by the readers after a file has been read. Symbols can
+  /// still be added afterwards, but that is more expensive.
+  void finalize() {
+    assertMutable();
+    _exports.finalize();
+    _undefineds.finalize();
+  }
+
+  /// \brief Finalize the file and mark it as immutable.
+  ///
+  /// Only frozen files may be shared between threads.
+  void freeze() {
+    finalize();
+    _isFrozen = true;
+  }
+  bool isFrozen() const { return _isFrozen; }
+
 protected:
-  template <typename C, typename T>
-  typename C::iterator addEntry(C &container, T &&installName) {
+  void assertMutable() const {
+    assert(!_isFrozen && "a frozen interface file must not be modified");
+  }
+
+  template <typename C>
+  typename C::iterator addEntry(C &container, StringRef installName) {
     auto it = find_if(container, [&installName](const InterfaceFileRef &lib) {
       return lib.getInstallName() == installName;
     });
     if (it == std::end(container)) {
       auto insertAt =
           lower_bound(container, installName,
-                      [](const InterfaceFileRef &lhs, const T &rhs) {
+                      [](const InterfaceFileRef &lhs, StringRef rhs) {
                         return lhs.getInstallName() < rhs;
                       });
 
-      it = container.emplace(insertAt, std::forward<T &&>(installName));
+      it = container.emplace(insertAt, _pool->intern(installName));
     }
     return it;
   }
 
+  /// The pool has to outlive all other members, which reference its strings.
+  std::shared_ptr<StringPool> _pool;
   Platform _platform = Platform::Unknown;
   ArchitectureSet _architectures;
-  std::string _installName;
+  StringRef _installName;
   PackedVersion _currentVersion;
   PackedVersion _compatibilityVersion;
   uint8_t _swiftVersion = 0;
   bool _isTwoLevelNamespace = false;
   bool _isAppExtensionSafe = false;
   ObjCConstraint _objcConstraint = ObjCConstraint::None;
-  std::string _parentUmbrella;
+  StringRef _parentUmbrella;
   std::vector<InterfaceFileRef> _allowableClients;
   std::vector<InterfaceFileRef> _reexportedLibraries;
-  std::vector<std::pair<Arch, std::string>> _uuids;
-  SymbolMap _exports;
-  SymbolMap _undefineds;
+  std::vector<std::pair<Arch, UUID>> _uuids;
+  SymbolSet _exports;
+  SymbolSet _undefineds;
+  bool _isFrozen = false;
 };
 
-template <typename T>
-void InterfaceFile::addExportedSymbol(T &&name, SymbolType type,
-                                      SymbolFlags flags,
-                                      ArchitectureSet archs) {
-  auto it = _exports.emplace(
-      std::piecewise_construct, std::forward_as_tuple(name, type),
-      std::forward_as_tuple(std::forward<T &&>(name), type, flags));
-  for (auto arch : archs)
-    it.first->second._availability.emplace(std::piecewise_construct,
-                                           std::forward_as_tuple(arch),
-                                           std::forward_as_tuple());
-}
-
-template <typename T>
-void InterfaceFile::addUndefinedSymbol(T &&name, SymbolType type,
-                                       SymbolFlags flags,
-                                       ArchitectureSet archs) {
-  auto it = _undefineds.emplace(
-      std::piecewise_construct, std::forward_as_tuple(name, type),
-      std::forward_as_tuple(std::forward<T &&>(name), type, flags));
-  for (auto arch : archs)
-    it.first->second._availability.emplace(std::piecewise_construct,
-                                           std::forward_as_tuple(arch),
-                                           std::forward_as_tuple());
-}
-
 TAPI_NAMESPACE_INTERNAL_END
 
 #endif // TAPI_CORE_INTERFACE_FILE_H
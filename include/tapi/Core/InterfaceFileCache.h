@@ -0,0 +1,108 @@
+//===- tapi/Core/InterfaceFileCache.h - Interface File Cache ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief A thread-safe, size-bounded cache of parsed interface files.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_INTERFACE_FILE_CACHE_H
+#define TAPI_CORE_INTERFACE_FILE_CACHE_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Core/ParsedInterfaceFile.h"
+#include "tapi/Core/Registry.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/StringMap.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief Caches parsed interface files keyed by path and content hash.
+///
+/// Each path maps to at most one entry. A lookup only hits when the size and
+/// the 128-bit hash of the provided content match the cached entry, so a file
+/// that changed on disk is transparently re-parsed and replaces the stale
+/// entry. The content itself is not kept; two different contents of the same
+/// size would have to collide in both independent 64-bit hashes to be
+/// confused. An entry that was read without some sections only serves lookups
+/// that skip these sections too.
+/// When the cache is full the least recently used entry is evicted. A capacity
+/// of zero disables the cache.
+class InterfaceFileCache {
+public:
+  using FilePtr = std::shared_ptr<const ParsedInterfaceFile>;
+
+  struct Statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+  };
+
+  /// \brief Identifies the content of a file.
+  struct Key {
+    /// The hash of the content, as computed by #computeHash.
+    uint64_t hash = 0;
+    /// An independent hash of the content, which makes up the other half of
+    /// the 128-bit hash.
+    uint64_t check = 0;
+    uint64_t size = 0;
+
+    static Key get(StringRef content);
+
+    bool operator==(const Key &rhs) const {
+      return hash == rhs.hash && check == rhs.check && size == rhs.size;
+    }
+    bool operator!=(const Key &rhs) const { return !(*this == rhs); }
+  };
+
+  explicit InterfaceFileCache(size_t capacity = 0) : _capacity(capacity) {}
+
+  static uint64_t computeHash(StringRef content);
+
+  FilePtr lookup(StringRef path, const Key &key, SkipFlags skipFlags);
+  void insert(StringRef path, const Key &key, FilePtr file,
+              SkipFlags skipFlags);
+
+  /// \brief Register the entry of the path under the alias too, if the path
+  /// is cached.
+  void insertAlias(StringRef alias, StringRef path);
+
+  void setCapacity(size_t capacity);
+  size_t getCapacity() const;
+  bool isEnabled() const { return getCapacity() != 0; }
+
+  void clear();
+  Statistics getStatistics() const;
+
+private:
+  struct Entry {
+    std::string path;
+    Key key;
+    FilePtr file;
+    SkipFlags skipFlags;
+  };
+  using EntryList = std::list<Entry>;
+
+  void evict(size_t capacity);
+
+  mutable std::mutex _mutex;
+  size_t _capacity;
+  EntryList _entries;
+  llvm::StringMap<EntryList::iterator> _index;
+  Statistics _stats;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_INTERFACE_FILE_CACHE_H
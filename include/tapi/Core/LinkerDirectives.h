@@ -0,0 +1,83 @@
+//===- tapi/Core/LinkerDirectives.h - TAPI Linker Directives ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the table of $ld$ linker directives of an interface file.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_LINKER_DIRECTIVES_H
+#define TAPI_CORE_LINKER_DIRECTIVES_H
+
+#include "tapi/Core/ArchitectureSupport.h"
+#include "tapi/Core/LLVM.h"
+#include "tapi/Core/Symbol.h"
+#include "tapi/Defines.h"
+#include "tapi/PackedVersion32.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <vector>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+class InterfaceFile;
+
+/// \brief The $ld$ linker directives of an interface file.
+///
+/// Exported symbols of the form $ld$<action>$os<version>$<name> change how the
+/// linker sees the library when linking for a specific deployment target. The
+/// directives are parsed once and grouped by OS version, so applying them only
+/// requires a lookup by deployment target.
+class LinkerDirectives {
+public:
+  enum class Action : uint8_t {
+    Hide,
+    Add,
+    InstallName,
+    CompatibilityVersion,
+    Unknown,
+  };
+
+  struct Directive {
+    PackedVersion32 osVersion;
+    Action action;
+    SymbolFlags flags;
+    ArchitectureSet archs;
+
+    /// The symbol name for Hide and Add, the install name for InstallName, and
+    /// the complete directive symbol name for Unknown.
+    StringRef name;
+
+    /// The version for CompatibilityVersion.
+    PackedVersion32 version;
+  };
+
+  LinkerDirectives() = default;
+
+  /// \brief Parse the directives of the interface file.
+  ///
+  /// The names reference the symbol names of the interface file, which has to
+  /// outlive the directives.
+  explicit LinkerDirectives(const InterfaceFile &file);
+
+  /// \brief Obtain the directives for the OS version in symbol name order.
+  llvm::ArrayRef<Directive> lookup(PackedVersion32 osVersion) const;
+
+  bool empty() const { return _directives.empty(); }
+
+  /// \brief Parse a version of the form major[.minor[.patch]].
+  static PackedVersion32 parseVersion(StringRef str);
+
+private:
+  /// Sorted by OS version and then symbol name.
+  std::vector<Directive> _directives;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_LINKER_DIRECTIVES_H
@@ -28,7 +28,8 @@ public:
   FileType getFileType(file_magic magic,
                        llvm::MemoryBufferRef bufferRef) const override;
   std::unique_ptr<File>
-  readFile(llvm::MemoryBufferRef memBuffer) const override;
+  readFile(llvm::MemoryBufferRef memBuffer, ReadFlags readFlags,
+           SkipFlags skipFlags) const override;
 };
 
 TAPI_NAMESPACE_INTERNAL_END
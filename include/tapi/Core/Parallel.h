@@ -0,0 +1,46 @@
+//===- tapi/Core/Parallel.h - Parallel Algorithms ---------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Simple parallel algorithms backed by a bounded set of threads.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_PARALLEL_H
+#define TAPI_CORE_PARALLEL_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/STLExtras.h"
+#include <cstddef>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief Return the number of worker threads to use for the given number of
+/// work items.
+///
+/// A thread count of zero selects the number of hardware threads. The result
+/// is never larger than the number of work items and at least one.
+unsigned getThreadCount(size_t count, unsigned threadCount);
+
+/// \brief Invoke the function for every index in [0, count).
+///
+/// The indices are distributed dynamically among at most threadCount threads
+/// (see getThreadCount). The calling thread participates in the work and the
+/// function only returns once all indices have been processed. If a thread
+/// cannot be started, the indices are processed by the threads that are
+/// already running, down to the calling thread alone. A parallelFor that is
+/// called from within the function of another one runs on the calling thread
+/// only. The function must not throw.
+void parallelFor(size_t count, unsigned threadCount,
+                 llvm::function_ref<void(size_t)> fn);
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_PARALLEL_H
@@ -0,0 +1,134 @@
+//===- tapi/Core/ParsedInterfaceFile.h - Parsed Interface File --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief A parsed interface file together with the data derived from it.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_PARSED_INTERFACE_FILE_H
+#define TAPI_CORE_PARSED_INTERFACE_FILE_H
+
+#include "tapi/Core/ArchitectureSupport.h"
+#include "tapi/Core/ExportFilter.h"
+#include "tapi/Core/InterfaceFile.h"
+#include "tapi/Core/LinkerDirectives.h"
+#include "tapi/Defines.h"
+#include "tapi/Symbol.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief A parsed interface file and the data derived from it.
+///
+/// The interface file is frozen and the derived data is computed once on first
+/// use, so the parsed file can be shared by any number of threads through a
+/// shared pointer. All methods are thread-safe. After the derived data has
+/// been computed, reading it doesn't take a lock.
+class ParsedInterfaceFile {
+public:
+  /// \brief The symbols of an architecture slice as seen by the linker.
+  struct Slice {
+    /// The exported symbols sorted by name, excluding the $ld$ directives.
+    std::vector<tapi::v1::Symbol> exports;
+
+    /// The undefined symbols sorted by name.
+    std::vector<tapi::v1::Symbol> undefineds;
+  };
+
+  /// \brief Create the parsed file.
+  ///
+  /// \param file The interface file, which has to be frozen.
+  /// \param filter The export filter recorded for the file, if there is one.
+  /// Otherwise the filter is created on first use.
+  explicit ParsedInterfaceFile(std::unique_ptr<const InterfaceFile> file,
+                               ExportFilter filter = ExportFilter());
+
+  const InterfaceFile &getInterfaceFile() const { return *_file; }
+  const LinkerDirectives &getLinkerDirectives() const { return _directives; }
+
+  /// \brief The architectures that have weak defined exports.
+  ArchitectureSet getWeakDefinedArchs() const { return _weakDefinedArchs; }
+
+  /// \brief The filter over the exported symbol names of all architectures.
+  const ExportFilter &getExportFilter() const;
+
+  /// \brief Call \p callback with every linker symbol name of the symbol.
+  ///
+  /// Objective-C symbols are prefixed with the name of their runtime
+  /// structure. The prefixed names are composed in \p buffer, which is reused
+  /// between calls to avoid an allocation per symbol.
+  template <typename Fn>
+  static void forEachLinkerName(const Symbol &symbol, bool useObjC1ABI,
+                                std::string &buffer, Fn callback) {
+    auto prefixed = [&](StringRef prefix) {
+      buffer.assign(prefix.data(), prefix.size());
+      buffer.append(symbol.getName().data(), symbol.getName().size());
+      callback(StringRef(buffer));
+    };
+
+    if (symbol.isSymbol()) {
+      callback(symbol.getName());
+    } else if (symbol.isObjCClass()) {
+      if (useObjC1ABI) {
+        prefixed(".objc_class_name");
+      } else {
+        prefixed("_OBJC_CLASS_$");
+        prefixed("_OBJC_METACLASS_$");
+      }
+    } else if (symbol.isObjCInstanceVariable()) {
+      prefixed("_OBJC_IVAR_$");
+    }
+  }
+
+  /// \brief Obtain the symbols of the architecture slice.
+  ///
+  /// The slice is created on first use and retained for the lifetime of the
+  /// parsed file.
+  const Slice &getSlice(Arch arch) const;
+
+  /// \brief Announce that the slices of the architectures will be requested.
+  ///
+  /// The first request for any of the announced slices creates all of them in
+  /// one pass over the symbols of the file.
+  void expectSlices(ArchitectureSet archs) const;
+
+  /// \brief Transfer the ownership of an existing slice to the caller.
+  ///
+  /// Only the last owner of the parsed file may take a slice, right before it
+  /// releases the parsed file.
+  std::unique_ptr<Slice> takeSlice(Arch arch) const;
+
+private:
+  std::unique_ptr<const InterfaceFile> _file;
+  LinkerDirectives _directives;
+  ArchitectureSet _weakDefinedArchs;
+
+  mutable std::once_flag _exportFilterFlag;
+  mutable ExportFilter _exportFilter;
+
+  static const unsigned maxArchs = sizeof(uint32_t) * 8;
+
+  /// The slices indexed by architecture. A slice is only published once it
+  /// is complete, which lets readers skip the lock.
+  mutable std::atomic<const Slice *> _publishedSlices[maxArchs];
+
+  /// The mutex guards the creation of the slices.
+  mutable std::mutex _mutex;
+  mutable std::unique_ptr<Slice> _slices[maxArchs];
+  mutable ArchitectureSet _expectedArchs;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_PARSED_INTERFACE_FILE_H
@@ -0,0 +1,160 @@
+//===- tapi/Core/ReexportResolver.h - Re-export Resolver --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Resolves the re-exported libraries of interface files.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_REEXPORT_RESOLVER_H
+#define TAPI_CORE_REEXPORT_RESOLVER_H
+
+#include "tapi/Core/ArchitectureSupport.h"
+#include "tapi/Core/InterfaceFile.h"
+#include "tapi/Core/LLVM.h"
+#include "tapi/Core/LinkerDirectives.h"
+#include "tapi/Defines.h"
+#include "tapi/PackedVersion32.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief The exports of a library and of all libraries it re-exports for one
+/// architecture, by the names the linker sees.
+///
+/// When several libraries export the same symbol, the one that is found first
+/// by a depth-first walk of the re-exports wins, which is the order in which
+/// the linker searches them.
+class FlatExports {
+public:
+  struct Export {
+    StringRef name;
+    SymbolFlags flags;
+    const InterfaceFile *file;
+
+    /// The install name of the file after the $ld$install_name directives.
+    StringRef installName;
+  };
+
+  using const_iterator = std::vector<Export>::const_iterator;
+
+  /// \brief Find the export with the linker name.
+  const Export *find(StringRef name) const;
+
+  size_t size() const { return _exports.size(); }
+  const_iterator begin() const { return _exports.begin(); }
+  const_iterator end() const { return _exports.end(); }
+
+private:
+  friend class ReexportResolver;
+
+  void add(StringRef name, SymbolFlags flags, const InterfaceFile &file,
+           StringRef installName);
+  void add(const FlatExports &other);
+
+  /// The prefixed Objective-C names are composed by the resolver, so they are
+  /// saved with the exports.
+  llvm::BumpPtrAllocator _allocator;
+  llvm::StringSaver _saver{_allocator};
+
+  std::vector<Export> _exports;
+  llvm::DenseMap<StringRef, unsigned> _index;
+};
+
+/// \brief Loads the graph of re-exported libraries once and answers export
+/// queries against it.
+///
+/// The resolver owns the files it has been given or has loaded, and links the
+/// re-exported library references of every file to the referenced file. The
+/// flattened exports of a library are computed on first use and memoized, so
+/// that repeated queries for the same umbrella framework don't walk the
+/// re-exports again. The $ld$ directives of every library are applied for the
+/// deployment target the resolver has been created with, the same way as
+/// LinkerInterfaceFile applies them. The resolver is meant to be used by one
+/// linker session and is not thread-safe.
+class ReexportResolver {
+public:
+  /// \brief Loads the file with the install name, or returns nullptr if there
+  /// is no such file.
+  using Loader =
+      std::function<std::unique_ptr<InterfaceFile>(StringRef installName)>;
+
+  /// \brief A re-export that closes a cycle, as a pair of install names.
+  using Cycle = std::pair<StringRef, StringRef>;
+
+  ReexportResolver(Loader loader, PackedVersion32 minOSVersion)
+      : _loader(std::move(loader)), _minOSVersion(minOSVersion) {}
+  ReexportResolver(const ReexportResolver &) = delete;
+  ReexportResolver &operator=(const ReexportResolver &) = delete;
+
+  /// \brief Add a file to the resolver, which takes ownership of it.
+  ///
+  /// \returns the file that was already registered for the install name, or
+  /// the new file.
+  InterfaceFile *addFile(std::unique_ptr<InterfaceFile> file);
+
+  /// \brief Find the file with the install name, loading it if necessary.
+  InterfaceFile *getFile(StringRef installName);
+
+  /// \brief Load the re-exported libraries of the file and transitively of
+  /// all libraries they re-export, and link the references to them.
+  void resolve(InterfaceFile &file);
+
+  /// \brief Obtain the exports of the file and of all libraries it
+  /// re-exports for the architecture.
+  ///
+  /// The file has to be resolved first. The result is memoized and remains
+  /// valid for the lifetime of the resolver.
+  const FlatExports &getExports(const InterfaceFile &file, Arch arch);
+
+  /// \brief The install names that could not be loaded.
+  const std::vector<StringRef> &getMissingLibraries() const {
+    return _missingLibraries;
+  }
+
+  /// \brief The re-exports that close a cycle. The exports of the libraries of
+  /// a cycle are still flattened, but only once.
+  const std::vector<Cycle> &getCycles() const { return _cycles; }
+
+private:
+  enum class State { Visiting, Resolved };
+
+  void collect(const InterfaceFile &file, Arch arch, const InterfaceFile &root,
+               FlatExports &result,
+               llvm::DenseSet<const InterfaceFile *> &visited) const;
+
+  Loader _loader;
+  PackedVersion32 _minOSVersion;
+  std::vector<std::unique_ptr<InterfaceFile>> _files;
+  llvm::DenseMap<const InterfaceFile *, LinkerDirectives> _directives;
+
+  llvm::StringMap<InterfaceFile *> _filesByInstallName;
+  llvm::StringSet<> _missingInstallNames;
+  llvm::DenseMap<const InterfaceFile *, State> _states;
+  llvm::DenseMap<std::pair<const InterfaceFile *, unsigned>,
+                 std::unique_ptr<FlatExports>>
+      _flatExports;
+
+  std::vector<StringRef> _missingLibraries;
+  std::vector<Cycle> _cycles;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_REEXPORT_RESOLVER_H
@@ -28,6 +28,43 @@ TAPI_NAMESPACE_INTERNAL_BEGIN
 
 class Registry;
 
+/// \brief Controls how much of a file is read.
+enum class ReadFlags : unsigned {
+  /// \brief Only read the header information of the file, such as the
+  /// install name, the versions, and the UUIDs. No symbols are read.
+  Header,
+
+  /// \brief Read the whole file.
+  All,
+};
+
+/// \brief Selects the sections of a file that are not read.
+///
+/// The readers skip these sections while parsing, so the caller pays neither
+/// the time to parse them nor the memory to store them. Skipped sections are
+/// not validated either.
+enum class SkipFlags : unsigned {
+  None                      = 0U,
+  Undefineds                = 1U << 0,
+  UUIDs                     = 1U << 1,
+  AllowableClients          = 1U << 2,
+};
+
+inline SkipFlags operator&(const SkipFlags lhs, const SkipFlags rhs) {
+  return static_cast<SkipFlags>(static_cast<unsigned>(lhs) &
+                                static_cast<unsigned>(rhs));
+}
+
+inline SkipFlags operator|(const SkipFlags lhs, const SkipFlags rhs) {
+  return static_cast<SkipFlags>(static_cast<unsigned>(lhs) |
+                                static_cast<unsigned>(rhs));
+}
+
+inline SkipFlags operator|=(SkipFlags &lhs, const SkipFlags rhs) {
+  lhs = lhs | rhs;
+  return lhs;
+}
+
 /// Abstract Reader class - all readers need to inherit from this class and
 /// implement the interface.
 class Reader {
@@ -37,7 +74,9 @@ public:
                        FileType types = FileType::All) const = 0;
   virtual FileType getFileType(file_magic magic,
                                MemoryBufferRef bufferRef) const = 0;
-  virtual std::unique_ptr<File> readFile(MemoryBufferRef memBuffer) const = 0;
+  virtual std::unique_ptr<File> readFile(MemoryBufferRef memBuffer,
+                                         ReadFlags readFlags,
+                                         SkipFlags skipFlags) const = 0;
 };
 
 /// Abstract Writer class - all writers need to inherit from this class and
@@ -47,6 +86,11 @@ public:
   virtual ~Writer() {}
   virtual bool canWrite(const File *file) const = 0;
   virtual std::error_code writeFile(const File *file) const = 0;
+
+  /// \brief Serialize the file into the stream instead of the file at its
+  /// path.
+  virtual std::error_code writeFile(llvm::raw_ostream &os,
+                                    const File *file) const = 0;
 };
 
 class Registry {
@@ -55,9 +99,36 @@ public:
   FileType getFileType(MemoryBufferRef memBuffer) const;
   bool canWrite(const File *file) const;
 
-  std::unique_ptr<File> readFile(MemoryBufferRef memBuffer) const;
+  std::unique_ptr<File> readFile(MemoryBufferRef memBuffer,
+                                 ReadFlags readFlags = ReadFlags::All,
+                                 SkipFlags skipFlags = SkipFlags::None) const;
   std::error_code writeFile(const File *file) const;
 
+  /// \brief Write the file, unless the file at its path already describes the
+  /// same interface.
+  ///
+  /// The existing file is read with the readers of the registry. Its header is
+  /// compared first, including the UUIDs, so a rebuilt library is detected
+  /// without reading the symbols. Otherwise the content digests are compared.
+  /// Output formats that don't represent all of the file's content, such as
+  /// TBD v1, never compare equal and are always written.
+  ///
+  /// \param written Is set to true if the file has been written.
+  std::error_code writeFileIfChanged(const File *file,
+                                     bool *written = nullptr) const;
+
+  /// \brief Serialize the file into the stream.
+  ///
+  /// The writer is selected the same way as for writing the file to disk, so
+  /// the path of the file still has to match the output format.
+  std::error_code writeFile(llvm::raw_ostream &os, const File *file) const;
+
+  /// \brief Serialize the file into a new memory buffer.
+  ///
+  /// The buffer identifier is the path of the file.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  writeFileToBuffer(const File *file) const;
+
   void add(std::unique_ptr<Reader> reader) {
     _readers.emplace_back(std::move(reader));
   }
@@ -69,6 +140,8 @@ public:
   void addBinaryReaders();
   void addYAMLReaders();
   void addYAMLWriters();
+  void addCompiledStubReaders();
+  void addCompiledStubWriters();
 
 private:
   std::vector<std::unique_ptr<Reader>> _readers;
@@ -0,0 +1,86 @@
+//===- tapi/Core/StringPool.h - Shared String Pool --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief A thread-safe pool of interned strings.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_STRING_POOL_H
+#define TAPI_CORE_STRING_POOL_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/StringRef.h"
+#include <atomic>
+#include <memory>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief Stores every distinct string once.
+///
+/// Interned strings stay valid for the lifetime of the pool. Two strings
+/// interned in the same pool are equal if and only if they have the same data
+/// pointer, which makes comparisons and hashing of interned strings cheap.
+///
+/// The pool is split into shards with their own lock. Looking up a string that
+/// has already been interned doesn't take a lock, only adding a new string
+/// does.
+///
+/// Interface files share the pool of the current session and keep it alive,
+/// so a pool is freed together with the last file that uses it. Individual
+/// strings are never removed, which is why files report the names they
+/// interned when they are destroyed. Once the released names could make up
+/// half of the pool, the pool is retired and new files start a new session.
+class StringPool {
+public:
+  StringPool();
+  ~StringPool();
+  StringPool(const StringPool &) = delete;
+  StringPool &operator=(const StringPool &) = delete;
+
+  /// \brief The pool of the current session, which is created on demand.
+  static std::shared_ptr<StringPool> getSession();
+
+  /// \brief End the current session, so that the next file starts a new one
+  /// with an empty pool. Existing files keep their pool.
+  static void startSession();
+
+  /// \brief Return the interned copy of the string, adding it if necessary.
+  StringRef intern(StringRef string);
+
+  /// \brief Return the interned copy of the string, or a null StringRef if
+  /// the string has not been interned.
+  StringRef lookup(StringRef string) const;
+
+  /// \brief The number of distinct strings in the pool.
+  size_t size() const;
+
+  /// \brief The number of bytes of all distinct strings in the pool.
+  size_t getByteCount() const;
+
+  /// \brief Record that a file which interned strings of the given size in
+  /// total no longer uses them.
+  void release(size_t bytes) {
+    _releasedBytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  /// \brief Check if the released strings could make up half of the pool,
+  /// in which case no new files should use it.
+  bool isRetired() const;
+
+private:
+  class Shard;
+  std::unique_ptr<Shard[]> _shards;
+  std::atomic<size_t> _releasedBytes;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_STRING_POOL_H
@@ -18,7 +18,9 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "tapi/Core/ArchitectureSupport.h"
 #include "tapi/Core/LLVM.h"
-#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
@@ -89,8 +91,20 @@ inline SymbolFlags operator|(const SymbolFlags &lhs,
 }
 
 struct Symbol {
-  std::string _name;
-  std::map<Arch, AvailabilityInfo> _availability;
+  using AvailabilityMap = std::vector<std::pair<Arch, AvailabilityInfo>>;
+
+  /// The name is not owned by the symbol. Symbols that belong to an interface
+  /// file reference the name storage of the file.
+  StringRef _name;
+
+  /// The architectures this symbol is available for.
+  ArchitectureSet _archs;
+
+  /// Availability information that differs from the default, sorted by
+  /// architecture. This is only allocated when needed, which is rarely the
+  /// case.
+  std::unique_ptr<AvailabilityMap> _availability;
+
   uint8_t _type : numSymbolTypeBits;
   uint8_t _flags : numSymbolFlagsBits;
   uint8_t _isPrivate : 1;
@@ -108,15 +122,24 @@ struct Symbol {
         _isPrivate(false), _isReexport(false) {}
 
   Symbol(const Symbol &sym)
-      : _name(sym._name), _type(sym._type), _flags(sym._flags),
-        _isPrivate(sym._isPrivate), _isReexport(sym._isReexport) {
-    for (auto &avail : sym._availability)
-      _availability.emplace(std::piecewise_construct,
-                            std::forward_as_tuple(avail.first),
-                            std::forward_as_tuple(avail.second));
+      : _name(sym._name), _archs(sym._archs), _type(sym._type),
+        _flags(sym._flags), _isPrivate(sym._isPrivate),
+        _isReexport(sym._isReexport) {
+    if (sym._availability)
+      _availability.reset(new AvailabilityMap(*sym._availability));
+  }
+
+  Symbol(Symbol &&) = default;
+
+  Symbol &operator=(const Symbol &sym) {
+    if (this != &sym)
+      *this = Symbol(sym);
+    return *this;
   }
 
-  const std::string &getName() const { return _name; }
+  Symbol &operator=(Symbol &&) = default;
+
+  StringRef getName() const { return _name; }
   std::string getPrettyName(bool demangle = false) const;
   std::string getAnnotatedName(bool demangle = false) const;
 
@@ -160,42 +183,46 @@ struct Symbol {
 
   SymbolFlags getFlags() const { return static_cast<SymbolFlags>(_flags); }
 
-  bool isUnavailable() const {
-    for (auto avail : _availability)
-      if (!avail.second._unavailable)
-        return false;
+  bool isUnavailable() const { return _archs.empty(); }
 
-    return true;
-  }
+  ArchitectureSet getArchitectures() const { return _archs; }
 
-  ArchitectureSet getArchitectures() const {
-    ArchitectureSet archs;
-    for (auto avail : _availability)
-      if (!avail.second._unavailable)
-        archs.set(avail.first);
+  bool hasArch(Arch arch) const { return _archs.has(arch); }
 
-    return archs;
+  /// \brief Find the non-default availability information for the
+  /// architecture.
+  const AvailabilityInfo *findAvailability(Arch arch) const;
+
+  /// \brief Check if there is any availability information for the
+  /// architecture, including information that marks it as unavailable.
+  bool hasAvailability(Arch arch) const {
+    return _archs.has(arch) || findAvailability(arch) != nullptr;
   }
 
-  bool hasArch(Arch arch) const {
-    auto it = _availability.find(arch);
-    if (it == _availability.end())
-      return false;
+  /// \brief Obtain the availability information for the architecture.
+  AvailabilityInfo getAvailability(Arch arch) const {
+    if (const auto *info = findAvailability(arch))
+      return *info;
+    return AvailabilityInfo();
+  }
 
-    if (it->second._unavailable)
-      return false;
+  /// \brief Add the default availability for all architectures that don't
+  /// have any availability information yet.
+  void addArchitectures(ArchitectureSet archs) {
+    if (!_availability) {
+      _archs |= archs;
+      return;
+    }
 
-    return true;
+    for (auto arch : archs)
+      addAvailability(arch, AvailabilityInfo());
   }
 
-  bool removeArch(Arch arch) {
-    auto it = _availability.find(arch);
-    if (it == _availability.end())
-      return false;
+  /// \brief Add the availability information for the architecture, unless
+  /// there is already some.
+  void addAvailability(Arch arch, const AvailabilityInfo &info);
 
-    _availability.erase(it);
-    return true;
-  }
+  bool removeArch(Arch arch);
 
   void print(raw_ostream &os) const;
 
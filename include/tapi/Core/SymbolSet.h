@@ -0,0 +1,103 @@
+//===- tapi/Core/SymbolSet.h - TAPI Symbol Set ------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief A flat set of symbols with interned names.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_SYMBOL_SET_H
+#define TAPI_CORE_SYMBOL_SET_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Core/StringPool.h"
+#include "tapi/Core/Symbol.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <vector>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief A set of symbols uniqued by name and type.
+///
+/// The symbol names are interned in the string pool of the file, so that the
+/// same name is only stored once no matter how many files of the session
+/// export it, and the symbols themselves are stored in a flat vector. While
+/// the set is being populated a hash index keyed by the interned name pointer
+/// is used to unique the symbols. Once the set has been finalized the symbols
+/// are sorted by name and type, the index is released, and lookups use a
+/// binary search instead.
+///
+/// The const methods don't modify the set, so they can be called concurrently
+/// as long as no thread modifies the set.
+class SymbolSet {
+public:
+  using const_iterator = std::vector<Symbol>::const_iterator;
+
+  explicit SymbolSet(StringPool &pool) : _pool(&pool) {}
+  SymbolSet(const SymbolSet &) = delete;
+  SymbolSet &operator=(const SymbolSet &) = delete;
+  SymbolSet(SymbolSet &&) = default;
+  SymbolSet &operator=(SymbolSet &&) = default;
+
+  /// \brief Insert a symbol, unless a symbol with the same name and type
+  /// already exists.
+  ///
+  /// \returns the symbol in the set and true if it has been newly inserted.
+  std::pair<Symbol *, bool> insert(StringRef name, SymbolType type,
+                                   SymbolFlags flags);
+
+  /// \brief Append a symbol that sorts after all symbols of the set.
+  ///
+  /// This is only possible while the set is sorted, and avoids building the
+  /// hash index and sorting the symbols for input that is already sorted.
+  ///
+  /// \returns false if the symbol doesn't sort after the last symbol.
+  bool append(StringRef name, SymbolType type, SymbolFlags flags,
+              ArchitectureSet archs);
+
+  void reserve(size_t size) { _symbols.reserve(size); }
+
+  Symbol *find(StringRef name, SymbolType type);
+  const Symbol *find(StringRef name, SymbolType type) const;
+  bool erase(StringRef name, SymbolType type);
+
+  /// \brief Sort the symbols and release the hash index.
+  void finalize();
+
+  size_t size() const { return _symbols.size(); }
+  bool empty() const { return _symbols.empty(); }
+  const_iterator begin() const { return _symbols.begin(); }
+  const_iterator end() const { return _symbols.end(); }
+
+  /// \brief The number of bytes of the names the set has interned.
+  size_t getNameBytes() const { return _nameBytes; }
+
+private:
+  /// Interned names are equal if they have the same storage.
+  using Key = std::pair<const char *, unsigned>;
+
+  static Key getKey(StringRef interned, SymbolType type) {
+    return std::make_pair(interned.data(), static_cast<unsigned>(type));
+  }
+
+  void rebuildIndex();
+  size_t lowerBound(StringRef name, SymbolType type) const;
+
+  StringPool *_pool;
+  std::vector<Symbol> _symbols;
+  llvm::DenseMap<Key, unsigned> _index;
+  size_t _nameBytes = 0;
+  bool _isSorted = true;
+};
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_SYMBOL_SET_H
@@ -75,6 +75,10 @@ class TextBasedStubDocumentHandler : public DocumentHandler {
   FileType getFileType(MemoryBufferRef memBufferRef) const override;
   bool canWrite(const File *file) const override;
   bool handleDocument(IO &io, const File *&f) const override;
+  std::unique_ptr<File> readFile(MemoryBufferRef memBufferRef,
+                                 ReadFlags readFlags,
+                                 SkipFlags skipFlags) const override;
+  bool writeFile(llvm::raw_ostream &os, const File *file) const override;
 };
 
 } // end namespace v2.
@@ -0,0 +1,79 @@
+//===- tapi/Core/UUID.h - TAPI UUID -----------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the UUID of a library.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_CORE_UUID_H
+#define TAPI_CORE_UUID_H
+
+#include "tapi/Core/LLVM.h"
+#include "tapi/Defines.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <string>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief A UUID stored as its 16 raw bytes.
+///
+/// The UUIDs of the dylib reader are never formatted unless they are written
+/// out, and comparing two UUIDs only compares their bytes. The textual form is
+/// the one of LC_UUID, e.g. 4C4C4402-5555-3144-A1F3-9C1B2E3A4D5E.
+class UUID {
+public:
+  static constexpr unsigned size = 16;
+
+  /// \brief The length of the textual form.
+  static constexpr unsigned stringLength = 36;
+
+  constexpr UUID() = default;
+  explicit UUID(const uint8_t *bytes) {
+    for (unsigned i = 0; i < size; ++i)
+      _bytes[i] = bytes[i];
+  }
+
+  const uint8_t *bytes() const { return _bytes; }
+
+  /// \brief Parse the textual form of a UUID. Hexadecimal digits may be lower
+  /// or upper case.
+  ///
+  /// \returns false if the string is not a UUID.
+  bool parse(StringRef str);
+
+  /// \brief Print the textual form with upper case digits.
+  void print(raw_ostream &os) const;
+  std::string str() const;
+
+  bool operator==(const UUID &rhs) const {
+    for (unsigned i = 0; i < size; ++i)
+      if (_bytes[i] != rhs._bytes[i])
+        return false;
+    return true;
+  }
+
+  bool operator!=(const UUID &rhs) const { return !(*this == rhs); }
+
+private:
+  /// \brief Format the textual form into the buffer without allocating.
+  void format(char (&buffer)[stringLength]) const;
+
+  uint8_t _bytes[size] = {};
+};
+
+inline raw_ostream &operator<<(raw_ostream &os, const UUID &uuid) {
+  uuid.print(os);
+  return os;
+}
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_CORE_UUID_H
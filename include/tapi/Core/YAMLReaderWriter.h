@@ -18,6 +18,7 @@
 #include "tapi/Core/File.h"
 #include "tapi/Core/Registry.h"
 #include "tapi/Defines.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Support/YAMLTraits.h"
 
 using llvm::MemoryBufferRef;
@@ -25,16 +26,27 @@ using llvm::yaml::IO;
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
+class DocumentHandler;
 class TextBasedStubBase;
 
 struct YAMLContext {
   const TextBasedStubBase &_base;
+  const DocumentHandler *_handler = nullptr;
+  SkipFlags _skipFlags = SkipFlags::None;
   std::string _path;
   std::string _errorMessage;
 
   YAMLContext(const TextBasedStubBase &base) : _base(base) {}
 };
 
+/// \brief Obtain the tag of a text-based stub file.
+///
+/// Only the identifier and the document markers at the start and the end of
+/// the buffer are inspected. Returns None if the buffer doesn't look like a
+/// text-based stub file, otherwise the tag that follows the document start
+/// marker. The tag is empty for untagged documents.
+llvm::Optional<llvm::StringRef> getDocumentTag(MemoryBufferRef memBufferRef);
+
 class DocumentHandler {
 public:
   virtual ~DocumentHandler() {}
@@ -42,6 +54,28 @@ public:
   virtual FileType getFileType(MemoryBufferRef bufferRef) const = 0;
   virtual bool canWrite(const File *file) const = 0;
   virtual bool handleDocument(IO &io, const File *&file) const = 0;
+
+  /// \brief Read the document directly from the buffer without going through
+  /// the generic YAML parser.
+  ///
+  /// Returns nullptr if the handler has no direct reader or if the document
+  /// uses constructs the direct reader doesn't support. In both cases the
+  /// document is read with the YAML parser instead.
+  virtual std::unique_ptr<File> readFile(MemoryBufferRef memBufferRef,
+                                         ReadFlags readFlags,
+                                         SkipFlags skipFlags) const {
+    return nullptr;
+  }
+
+  /// \brief Write the document directly to the stream without going through
+  /// the generic YAML writer.
+  ///
+  /// Returns false if the handler has no direct writer. Nothing has been
+  /// written to the stream in that case and the document is written with the
+  /// YAML writer instead.
+  virtual bool writeFile(llvm::raw_ostream &os, const File *file) const {
+    return false;
+  }
 };
 
 class TextBasedStubBase {
@@ -51,6 +85,13 @@ public:
   bool canWrite(const File *file) const;
   bool handleDocument(IO &io, const File *&file) const;
 
+  /// \brief Find the handler that can read the buffer.
+  const DocumentHandler *findHandler(MemoryBufferRef memBufferRef,
+                                     FileType types) const;
+
+  /// \brief Find the handler that can write the file.
+  const DocumentHandler *findHandler(const File *file) const;
+
   void add(std::unique_ptr<DocumentHandler> handler) {
     _documentHandlers.emplace_back(std::move(handler));
   }
@@ -65,13 +106,17 @@ public:
                FileType types) const override;
   FileType getFileType(file_magic magic,
                        MemoryBufferRef bufferRef) const override;
-  std::unique_ptr<File> readFile(MemoryBufferRef memBuffer) const override;
+  std::unique_ptr<File> readFile(MemoryBufferRef memBuffer,
+                                 ReadFlags readFlags,
+                                 SkipFlags skipFlags) const override;
 };
 
 class TextBasedStubWriter final : public TextBasedStubBase, public Writer {
 public:
   bool canWrite(const File *file) const override;
   std::error_code writeFile(const File *file) const override;
+  std::error_code writeFile(llvm::raw_ostream &os,
+                            const File *file) const override;
 };
 
 TAPI_NAMESPACE_INTERNAL_END
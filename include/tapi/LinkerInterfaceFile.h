@@ -16,8 +16,10 @@
 #define TAPI_LINKER_INTERFACE_FILE_H
 
 #include <tapi/Defines.h>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 ///
@@ -34,6 +36,7 @@ TAPI_NAMESPACE_V1_BEGIN
 
 class PackedVersion32;
 class Symbol;
+enum class SymbolFlags : unsigned;
 
 ///
 /// \brief Defines a list of supported platforms.
@@ -120,8 +123,381 @@ enum class CpuSubTypeMatching : unsigned {
   Exact = 1,
 };
 
+///
+/// \brief Defines flags that control how a file is parsed.
+/// \since 1.1
+///
+enum class ParsingFlags : unsigned {
+  /// \brief No flags.
+  /// \since 1.1
+  None = 0,
+
+  /// \brief Only accept a slice if the cpu sub type matches.
+  /// \since 1.1
+  ExactCpuSubType = 1U << 0,
+
+  /// \brief The caller guarantees that the memory following the buffer is
+  ///        readable up to the end of its page and zero-filled, as is the case
+  ///        for memory mapped files.
+  ///
+  /// This allows the file to be parsed in place without copying the buffer. A
+  /// copy is still made when the buffer ends exactly on a page boundary or
+  /// isn't followed by a null byte.
+  /// \since 1.1
+  NullTerminatedBuffer = 1U << 1,
+
+  /// \brief Don't read the undefined symbols.
+  ///
+  /// The undefined symbols are skipped while parsing and the file reports an
+  /// empty list of undefined symbols. Only the undefined symbols of flat
+  /// namespace libraries are of interest to the linker.
+  /// \since 1.1
+  SkipUndefineds = 1U << 2,
+
+  /// \brief Don't read the allowable clients.
+  ///
+  /// The allowable clients are skipped while parsing and the file reports no
+  /// allowable clients.
+  /// \since 1.1
+  SkipAllowableClients = 1U << 3,
+
+  /// \brief Use an up-to-date compiled stub file written by
+  ///        #LinkerInterfaceFile::writeCompiledStubFile instead of parsing the
+  ///        text-based stub file.
+  ///
+  /// Looks for a file with the extension ".tbdc" next to the text-based stub
+  /// file whenever the file isn't found in the parsed file cache. The compiled
+  /// stub file is only used if it has been compiled from the same content.
+  /// \since 1.1
+  PreferCompiledStub = 1U << 4,
+};
+
+/// \since 1.1
+inline ParsingFlags operator|(ParsingFlags lhs, ParsingFlags rhs) noexcept {
+  return static_cast<ParsingFlags>(static_cast<unsigned>(lhs) |
+                                   static_cast<unsigned>(rhs));
+}
+
+/// \since 1.1
+inline ParsingFlags operator&(ParsingFlags lhs, ParsingFlags rhs) noexcept {
+  return static_cast<ParsingFlags>(static_cast<unsigned>(lhs) &
+                                   static_cast<unsigned>(rhs));
+}
+
+/// \since 1.1
+inline ParsingFlags &operator|=(ParsingFlags &lhs, ParsingFlags rhs) noexcept {
+  lhs = lhs | rhs;
+  return lhs;
+}
+
+///
+/// \brief Statistics of the process-wide parsed file cache.
+/// \since 1.1
+///
+struct CacheStatistics {
+  /// \brief Number of lookups that were served from the cache.
+  /// \since 1.1
+  uint64_t hits = 0;
+
+  /// \brief Number of lookups that required parsing the file.
+  /// \since 1.1
+  uint64_t misses = 0;
+
+  /// \brief Number of entries that have been evicted from the cache.
+  /// \since 1.1
+  uint64_t evictions = 0;
+
+  /// \brief Number of entries currently held by the cache.
+  /// \since 1.1
+  uint64_t entries = 0;
+};
+
+///
+/// \brief Process-wide timings and counters of the library.
+///
+/// All times are in nanoseconds. The phases may nest, e.g. the parse time
+/// includes the denormalize time.
+/// \since 1.1
+///
+struct Statistics {
+  /// \brief Time spent copying buffers that are not null-terminated.
+  /// \since 1.1
+  uint64_t copyTime = 0;
+
+  /// \brief Time spent reading text-based stub files.
+  /// \since 1.1
+  uint64_t parseTime = 0;
+
+  /// \brief Time spent creating interface files from the parsed YAML.
+  /// \since 1.1
+  uint64_t denormalizeTime = 0;
+
+  /// \brief Time spent creating the symbol lists of an architecture.
+  /// \since 1.1
+  uint64_t projectionTime = 0;
+
+  /// \brief Time spent sorting symbol and library lists.
+  /// \since 1.1
+  uint64_t sortTime = 0;
+
+  /// \brief Time spent collecting and applying the $ld$ directives.
+  /// \since 1.1
+  uint64_t linkerDirectivesTime = 0;
+
+  /// \brief Time spent reading MachO dynamic libraries.
+  /// \since 1.1
+  uint64_t readBinaryTime = 0;
+
+  /// \brief Number of files returned by LinkerInterfaceFile::create.
+  /// \since 1.1
+  uint64_t filesCreated = 0;
+
+  /// \brief Number of text-based stub files read.
+  /// \since 1.1
+  uint64_t textFilesRead = 0;
+
+  /// \brief Number of MachO dynamic libraries read.
+  /// \since 1.1
+  uint64_t binaryFilesRead = 0;
+
+  /// \brief Number of bytes read from text-based stub files and dynamic
+  /// libraries.
+  /// \since 1.1
+  uint64_t bytesRead = 0;
+
+  /// \brief Number of exported and undefined symbols read.
+  /// \since 1.1
+  uint64_t symbolsRead = 0;
+};
+
+///
+/// \brief A file buffer to be parsed by LinkerInterfaceFile::createBatch.
+/// \since 1.1
+///
+struct FileBuffer {
+  /// \brief Full path to the file.
+  /// \since 1.1
+  std::string path;
+
+  /// \brief Raw pointer to start of buffer.
+  /// \since 1.1
+  const uint8_t *data = nullptr;
+
+  /// \brief Size of the buffer in bytes.
+  /// \since 1.1
+  size_t size = 0;
+};
+
+///
+/// \brief A cpu type and sub type selecting a slice for
+///        LinkerInterfaceFile::createSlices.
+/// \since 1.1
+///
+struct CpuType {
+  /// \brief The cpu type / architecture.
+  /// \since 1.1
+  cpu_type_t type = 0;
+
+  /// \brief The cpu sub type / sub architecture.
+  /// \since 1.1
+  cpu_subtype_t subType = 0;
+};
+
+class LinkerInterfaceFile;
+
+///
+/// \brief The result of parsing one file with LinkerInterfaceFile::createBatch.
+/// \since 1.1
+///
+struct BatchResult {
+  /// \brief The parsed file, or nullptr on error. The caller takes ownership.
+  /// \since 1.1
+  LinkerInterfaceFile *file = nullptr;
+
+  /// \brief Holds an error message when file is a nullptr.
+  /// \since 1.1
+  std::string errorMessage;
+};
+
+///
+/// \brief Callback for LinkerInterfaceFile::visitExports and
+///        LinkerInterfaceFile::visitUndefineds.
+///
+/// The symbol name is passed as a pointer and a length. It is not
+/// null-terminated and only valid for the duration of the call.
+/// \since 1.1
+///
+using SymbolVisitor =
+    std::function<void(const char *name, size_t length, SymbolFlags flags)>;
+
+///
+/// \brief Progress callback for LinkerInterfaceFile::prefetch and
+///        LinkerInterfaceFile::prefetchDirectory.
+///
+/// Invoked from a background thread after each file with the number of files
+/// processed so far and the total number of files. Calls are serialized, so the
+/// callback doesn't need to be thread-safe, but it should return quickly.
+/// \since 1.1
+///
+using PrefetchProgress = std::function<void(size_t completed, size_t total)>;
+
+///
+/// \brief Callback for LinkerInterfaceFile::createReexportSession that
+///        locates a library.
+///
+/// Returns the full path of the text-based stub file or dylib with the install
+/// name, or an empty string if the library can't be found.
+/// \since 1.1
+///
+using LibraryLocator =
+    std::function<std::string(const std::string &installName)>;
+
+///
+/// \brief A handle to a prefetch running on background threads.
+///
+/// Destroying the handle cancels the prefetch and waits for the background
+/// threads to finish.
+/// \since 1.1
+///
+class TAPI_PUBLIC PrefetchHandle {
+public:
+  ///
+  /// \brief Cancel the prefetch and wait for the background threads.
+  /// \since 1.1
+  ///
+  ~PrefetchHandle() noexcept;
+
+  ///
+  /// \brief Cancel the prefetch.
+  ///
+  /// Files that are already being parsed are still added to the cache, but no
+  /// further files are read. Doesn't wait for the background threads.
+  /// \since 1.1
+  ///
+  void cancel() noexcept;
+
+  ///
+  /// \brief Wait until all files have been processed or the prefetch has been
+  ///        cancelled.
+  /// \since 1.1
+  ///
+  void wait() noexcept;
+
+  ///
+  /// \brief Query if the prefetch has finished.
+  /// \return Returns true once the background threads have finished.
+  /// \since 1.1
+  ///
+  bool isDone() const noexcept;
+
+  ///
+  /// \brief Query the number of files that have been processed.
+  /// \since 1.1
+  ///
+  size_t getCompletedCount() const noexcept;
+
+  ///
+  /// \brief Query the number of processed files that could not be read or
+  ///        parsed.
+  /// \since 1.1
+  ///
+  size_t getFailedCount() const noexcept;
+
+  ///
+  /// \brief Query the number of files to process.
+  /// \return Returns zero until the files of the directory have been found.
+  /// \since 1.1
+  ///
+  size_t getTotalCount() const noexcept;
+
+  PrefetchHandle(const PrefetchHandle &) noexcept = delete;
+  PrefetchHandle &operator=(const PrefetchHandle &) noexcept = delete;
+
+private:
+  friend class LinkerInterfaceFile;
+  PrefetchHandle() noexcept;
+
+  class Impl;
+  std::unique_ptr<Impl> _pImpl;
+};
+
+///
+/// \brief Resolves the re-exported libraries of umbrella libraries for one
+///        link.
+///
+/// The session loads every library of the re-export graph only once and keeps
+/// it for its lifetime. The exports of a library and of all libraries it
+/// re-exports are combined on first use, so that repeated lookups against an
+/// umbrella framework don't chase its re-exports again. Re-exports that form a
+/// cycle are only followed once.
+///
+/// A session is meant to be used by a single link and is not thread-safe.
+/// \since 1.1
+///
+class TAPI_PUBLIC ReexportSession {
+public:
+  ///
+  /// \brief Release all libraries loaded by the session.
+  /// \since 1.1
+  ///
+  ~ReexportSession() noexcept;
+
+  ///
+  /// \brief Lookup an exported symbol of the library or of any library it
+  ///        re-exports, transitively.
+  ///
+  /// When several libraries export the symbol, the first one found by a
+  /// depth-first walk of the re-exports wins, which is the order in which the
+  /// linker searches them. The $ld$ directives of every library are applied
+  /// for the deployment target of the session, so hidden symbols are not
+  /// found and the install name is the one the linker records.
+  ///
+  /// \param[in] installName the install name of the library.
+  /// \param[in] name the symbol name as seen by the linker.
+  /// \param[out] flags holds the symbol flags when the return value is true.
+  /// \param[out] libraryInstallName holds the install name of the library that
+  ///             exports the symbol when the return value is true.
+  /// \return Returns true if the symbol is exported.
+  /// \since 1.1
+  ///
+  bool findExport(const std::string &installName, const std::string &name,
+                  SymbolFlags &flags, std::string &libraryInstallName) noexcept;
+
+  ///
+  /// \brief Query the install names that could not be located or read.
+  /// \since 1.1
+  ///
+  std::vector<std::string> getMissingLibraries() const noexcept;
+
+  ///
+  /// \brief Query the re-exports that close a cycle.
+  /// \return Returns the install names of the re-exporting and the re-exported
+  ///         library for every such re-export.
+  /// \since 1.1
+  ///
+  std::vector<std::pair<std::string, std::string>>
+  getReexportCycles() const noexcept;
+
+  ReexportSession(const ReexportSession &) noexcept = delete;
+  ReexportSession &operator=(const ReexportSession &) noexcept = delete;
+
+private:
+  friend class LinkerInterfaceFile;
+  ReexportSession(cpu_type_t cpuType, cpu_subtype_t cpuSubType,
+                  ParsingFlags flags, PackedVersion32 minOSVersion,
+                  LibraryLocator locator) noexcept;
+
+  class Impl;
+  std::unique_ptr<Impl> _pImpl;
+};
+
 ///
 /// \brief TAPI File APIs
+///
+/// The const methods of a file can be called concurrently from multiple
+/// threads. Files created from the same parsed library share its contents,
+/// so different files can be used by different threads without locking.
+///
 /// \since 1.0
 ///
 class TAPI_PUBLIC LinkerInterfaceFile {
@@ -175,6 +551,29 @@ public:
   static bool areEquivalent(const std::string &tbdPath,
                             const std::string &dylibPath) noexcept;
 
+  ///
+  /// \brief Compute the fingerprint of the interface of a library.
+  ///
+  /// The fingerprint covers the install name, the current and compatibility
+  /// version, and the exported symbols and reexported libraries of every
+  /// architecture. It doesn't depend on the file format, so a MachO dynamic
+  /// library and the text-based stub file generated from it have the same
+  /// fingerprint. Build systems can use it as a cache key that only changes
+  /// when the interface of the library changes.
+  ///
+  /// \param[in] path full path to the file.
+  /// \param[in] data raw pointer to start of buffer.
+  /// \param[in] size size of the buffer in bytes.
+  /// \param[out] errorMessage holds an error message when the return value is
+  ///             empty.
+  /// \return Returns the 128-bit fingerprint as 32 hexadecimal digits, or an
+  ///         empty string on error.
+  /// \since 1.1
+  ///
+  static std::string
+  getInterfaceFingerprint(const std::string &path, const uint8_t *data,
+                          size_t size, std::string &errorMessage) noexcept;
+
   ///
   /// \brief Create a LinkerInterfaceFile from the provided buffer.
   ///
@@ -201,6 +600,241 @@ public:
          CpuSubTypeMatching matchingMode, PackedVersion32 minOSVersion,
          std::string &errorMessage) noexcept;
 
+  ///
+  /// \brief Create a LinkerInterfaceFile from the provided buffer.
+  ///
+  /// Parses the content of the provided buffer with the given constrains for
+  /// cpu type, cpu sub-type, parsing flags, and minimum deployment version.
+  ///
+  /// \param[in] path full path to the file.
+  /// \param[in] data raw pointer to start of buffer.
+  /// \param[in] size size of the buffer in bytes.
+  /// \param[in] cpuType The cpu type / architecture to check the file for.
+  /// \param[in] cpuSubType The cpu sub type / sub architecture to check the
+  ///            file for.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] minOSVersion The minimum OS version / deployment target.
+  /// \param[out] errorMessage holds an error message when the return value is a
+  ///             nullptr.
+  /// \return nullptr on error
+  /// \since 1.1
+  ///
+  static LinkerInterfaceFile *
+  create(const std::string &path, const uint8_t *data, size_t size,
+         cpu_type_t cpuType, cpu_subtype_t cpuSubType, ParsingFlags flags,
+         PackedVersion32 minOSVersion, std::string &errorMessage) noexcept;
+
+  ///
+  /// \brief Create LinkerInterfaceFiles from the provided buffers.
+  ///
+  /// Parses the content of all provided buffers concurrently with the given
+  /// constrains for cpu type, cpu sub-type, parsing flags, and minimum
+  /// deployment version. Each buffer is processed as if it was passed to
+  /// #create.
+  ///
+  /// \param[in] files the buffers to parse.
+  /// \param[in] cpuType The cpu type / architecture to check the files for.
+  /// \param[in] cpuSubType The cpu sub type / sub architecture to check the
+  ///            files for.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] minOSVersion The minimum OS version / deployment target.
+  /// \param[in] threadCount The maximum number of threads to use. Zero selects
+  ///            the number of hardware threads.
+  /// \return Returns one result per buffer in the same order as the input.
+  /// \since 1.1
+  ///
+  static std::vector<BatchResult>
+  createBatch(const std::vector<FileBuffer> &files, cpu_type_t cpuType,
+              cpu_subtype_t cpuSubType, ParsingFlags flags,
+              PackedVersion32 minOSVersion, unsigned threadCount = 0) noexcept;
+
+  ///
+  /// \brief Create LinkerInterfaceFiles for several slices of the provided
+  ///        buffer.
+  ///
+  /// Parses the content of the provided buffer once and creates one file per
+  /// cpu type, as if the buffer was passed to #create for each of them. The
+  /// files share the parsed representation, and their symbol lists are
+  /// created together in one pass over the symbols of the buffer.
+  ///
+  /// \param[in] path full path to the file.
+  /// \param[in] data raw pointer to start of buffer.
+  /// \param[in] size size of the buffer in bytes.
+  /// \param[in] cpuTypes The cpu types / architectures to create files for.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] minOSVersion The minimum OS version / deployment target.
+  /// \return Returns one result per cpu type in the same order as the input.
+  /// \since 1.1
+  ///
+  static std::vector<BatchResult>
+  createSlices(const std::string &path, const uint8_t *data, size_t size,
+               const std::vector<CpuType> &cpuTypes, ParsingFlags flags,
+               PackedVersion32 minOSVersion) noexcept;
+
+  ///
+  /// \brief Write the compiled stub file for the provided buffer.
+  ///
+  /// Parses the content of the provided text-based stub file and writes a
+  /// binary image of it next to the file, using the extension ".tbdc". With
+  /// ParsingFlags::PreferCompiledStub #create uses this image instead of
+  /// parsing the text-based stub file as long as the text-based stub file's
+  /// content doesn't change.
+  ///
+  /// \param[in] path full path to the text-based stub file.
+  /// \param[in] data raw pointer to start of buffer.
+  /// \param[in] size size of the buffer in bytes.
+  /// \param[out] errorMessage holds an error message when the return value is
+  ///             false.
+  /// \return true on success.
+  /// \since 1.1
+  ///
+  static bool writeCompiledStubFile(const std::string &path,
+                                    const uint8_t *data, size_t size,
+                                    std::string &errorMessage) noexcept;
+
+  ///
+  /// \brief Set the capacity of the process-wide parsed file cache.
+  ///
+  /// When enabled, #create keeps the parsed representation of a file keyed by
+  /// its path and a 128-bit hash and the size of its content. Subsequent calls
+  /// for the same file only perform the architecture specific processing. The
+  /// least recently used file is evicted once the capacity is reached. A
+  /// capacity of zero disables the cache, which is the default.
+  ///
+  /// \param[in] capacity maximum number of parsed files to keep.
+  /// \since 1.1
+  ///
+  static void setCacheCapacity(unsigned capacity) noexcept;
+
+  ///
+  /// \brief Query the capacity of the process-wide parsed file cache.
+  /// \return Returns the maximum number of parsed files kept by the cache.
+  /// \since 1.1
+  ///
+  static unsigned getCacheCapacity() noexcept;
+
+  ///
+  /// \brief Remove all entries from the process-wide parsed file cache.
+  /// \since 1.1
+  ///
+  static void clearCache() noexcept;
+
+  ///
+  /// \brief Obtain the statistics of the process-wide parsed file cache.
+  /// \return Returns the accumulated cache hit, miss, and eviction counters.
+  /// \since 1.1
+  ///
+  static CacheStatistics getCacheStatistics() noexcept;
+
+  ///
+  /// \brief Parse the provided files into the process-wide parsed file cache
+  ///        on background threads.
+  ///
+  /// Meant for long-running linker processes, so that the files are already
+  /// parsed when they are needed and #create is served from the cache. Each
+  /// file is read and parsed as if it was passed to #create with the provided
+  /// flags. Paths that resolve to the same file, e.g. through the symlinks of
+  /// a framework bundle, are only parsed once and cached under every path.
+  ///
+  /// The cache has to be enabled with #setCacheCapacity and should be large
+  /// enough to hold all files, otherwise the prefetch does nothing or evicts
+  /// the files it added first.
+  ///
+  /// \param[in] paths full paths to the text-based stub files.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] progress Invoked after each file, may be empty.
+  /// \param[in] threadCount The maximum number of threads to use. Zero selects
+  ///            the number of hardware threads.
+  /// \return Returns the handle of the prefetch, which the caller takes
+  ///         ownership of, or nullptr if the background thread could not be
+  ///         started.
+  /// \since 1.1
+  ///
+  static PrefetchHandle *prefetch(const std::vector<std::string> &paths,
+                                  ParsingFlags flags,
+                                  PrefetchProgress progress = nullptr,
+                                  unsigned threadCount = 0) noexcept;
+
+  ///
+  /// \brief Parse all text-based stub files of the directory into the
+  ///        process-wide parsed file cache on background threads.
+  ///
+  /// Searches the directory recursively for files with one of the
+  /// #getSupportedFileExtensions, e.g. the root of an SDK, and prefetches them
+  /// as if they were passed to #prefetch. The search runs on the background
+  /// thread too.
+  ///
+  /// \param[in] directory full path to the directory.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] progress Invoked after each file, may be empty.
+  /// \param[in] threadCount The maximum number of threads to use. Zero selects
+  ///            the number of hardware threads.
+  /// \return Returns the handle of the prefetch, which the caller takes
+  ///         ownership of, or nullptr if the directory is empty or the
+  ///         background thread could not be started.
+  /// \since 1.1
+  ///
+  static PrefetchHandle *prefetchDirectory(const std::string &directory,
+                                           ParsingFlags flags,
+                                           PrefetchProgress progress = nullptr,
+                                           unsigned threadCount = 0) noexcept;
+
+  ///
+  /// \brief Create a session that resolves the re-exported libraries of
+  ///        umbrella libraries for one link.
+  ///
+  /// The session reads the libraries of the re-export graph itself, text-based
+  /// stub files as well as dylibs, and doesn't use the parsed file cache. Their
+  /// undefined symbols and allowable clients are never read.
+  ///
+  /// \param[in] cpuType The cpu type of the link.
+  /// \param[in] cpuSubType The cpu sub type of the link.
+  /// \param[in] flags Flags that control the parsing.
+  /// \param[in] minOSVersion The minimum OS version / deployment target.
+  /// \param[in] locator Returns the path of the library with an install name.
+  /// \return Returns the session, which the caller takes ownership of, or
+  ///         nullptr on error.
+  /// \since 1.1
+  ///
+  static ReexportSession *
+  createReexportSession(cpu_type_t cpuType, cpu_subtype_t cpuSubType,
+                        ParsingFlags flags, PackedVersion32 minOSVersion,
+                        LibraryLocator locator) noexcept;
+
+  ///
+  /// \brief Enable or disable the collection of process-wide statistics.
+  ///
+  /// Collection is disabled by default, unless the environment variable
+  /// TAPI_STATISTICS is set. Setting TAPI_TRACE also enables collection and
+  /// prints the statistics of every call to #create and a summary at exit to
+  /// the standard error stream.
+  ///
+  /// \param[in] enabled whether to collect statistics.
+  /// \since 1.1
+  ///
+  static void setStatisticsEnabled(bool enabled) noexcept;
+
+  ///
+  /// \brief Query if process-wide statistics are collected.
+  /// \return Returns true if statistics are collected.
+  /// \since 1.1
+  ///
+  static bool isStatisticsEnabled() noexcept;
+
+  ///
+  /// \brief Obtain the process-wide statistics.
+  /// \return Returns the timings and counters accumulated since the last
+  ///         reset.
+  /// \since 1.1
+  ///
+  static Statistics getStatistics() noexcept;
+
+  ///
+  /// \brief Reset the process-wide statistics to zero.
+  /// \since 1.1
+  ///
+  static void resetStatistics() noexcept;
+
   ///
   /// \brief Query the file type.
   /// \return Returns the file type this TAPI file represents.
@@ -301,6 +935,20 @@ public:
   ///
   const std::string &getParentFrameworkName() const noexcept;
 
+  ///
+  /// \brief Obtain the fingerprint of the interface of the library.
+  ///
+  /// The fingerprint covers all architectures of the library, not only the
+  /// one of this file. See #getInterfaceFingerprint(const std::string &, const
+  /// uint8_t *, size_t, std::string &). It is computed on first use.
+  ///
+  /// \return Returns the 128-bit fingerprint as 32 hexadecimal digits, or an
+  ///         empty string if #releaseParsedData released the parsed library
+  ///         before the fingerprint was computed.
+  /// \since 1.1
+  ///
+  std::string getInterfaceFingerprint() const noexcept;
+
   ///
   /// \brief Obtain the list of allowable clients.
   /// \return Returns a list of allowable clients.
@@ -322,13 +970,113 @@ public:
   ///
   const std::vector<std::string> &ignoreExports() const noexcept;
 
+  ///
+  /// \brief Take the list of allowable clients.
+  ///
+  /// Moves the list out of the file instead of copying it. Afterwards
+  /// #allowableClients returns an empty list.
+  ///
+  /// \return Returns a list of allowable clients.
+  /// \since 1.1
+  ///
+  std::vector<std::string> takeAllowableClients() noexcept;
+
+  ///
+  /// \brief Take the list of re-exported libraries.
+  ///
+  /// Moves the list out of the file instead of copying it. Afterwards
+  /// #reexportedLibraries returns an empty list.
+  ///
+  /// \return Returns a list of re-exported libraries.
+  /// \since 1.1
+  ///
+  std::vector<std::string> takeReexportedLibraries() noexcept;
+
+  ///
+  /// \brief Take the list of all symbols to be ignored.
+  ///
+  /// Moves the list out of the file instead of copying it. Afterwards
+  /// #ignoreExports returns an empty list. Symbol lookups are not affected.
+  ///
+  /// \return Returns a list of to all symbols that should be ignored.
+  /// \since 1.1
+  ///
+  std::vector<std::string> takeIgnoreExports() noexcept;
+
+  ///
+  /// \brief Query if the library exports the symbol.
+  ///
+  /// The lookup is performed against the parsed file and doesn't require the
+  /// list of exported symbols to be materialized.
+  ///
+  /// \param[in] name the symbol name as seen by the linker.
+  /// \return Returns true if the symbol is exported.
+  /// \since 1.1
+  ///
+  bool containsExport(const std::string &name) const noexcept;
+
+  ///
+  /// \brief Query if the library might export the symbol.
+  ///
+  /// The query uses a Bloom filter over the exported symbol names and doesn't
+  /// search the exports. It never returns false for a symbol that is exported,
+  /// but returns true for about one percent of the symbols that are not. This
+  /// allows to skip most libraries quickly when resolving a symbol.
+  ///
+  /// \param[in] name pointer to the symbol name as seen by the linker.
+  /// \param[in] length length of the symbol name.
+  /// \return Returns false if the symbol is definitely not exported.
+  /// \since 1.1
+  ///
+  bool mayExport(const char *name, size_t length) const noexcept;
+
+  ///
+  /// \brief Query if the library might export the symbol.
+  /// \param[in] name the symbol name as seen by the linker.
+  /// \return Returns false if the symbol is definitely not exported.
+  /// \since 1.1
+  ///
+  bool mayExport(const std::string &name) const noexcept;
+
+  ///
+  /// \brief Lookup an exported symbol.
+  ///
+  /// The lookup is performed against the parsed file and doesn't require the
+  /// list of exported symbols to be materialized.
+  ///
+  /// \param[in] name the symbol name as seen by the linker.
+  /// \param[out] flags holds the symbol flags when the return value is true.
+  /// \return Returns true if the symbol is exported.
+  /// \since 1.1
+  ///
+  bool findExport(const std::string &name, SymbolFlags &flags) const noexcept;
+
   ///
   /// \brief Obtain a list of all exported symbols.
+  ///
+  /// The list is created on first use. Prefer #findExport when only a few
+  /// symbols need to be looked up.
+  ///
   /// \return Returns a list of to all exported symbols.
   /// \since 1.0
   ///
   const std::vector<Symbol> &exports() const noexcept;
 
+  ///
+  /// \brief Release the parsed library if it isn't shared with the cache or
+  ///        other files.
+  ///
+  /// Creates the list of exported symbols, and answers all lookups and visits
+  /// from the lists of this file and a copy of the export filter from then on.
+  /// Does nothing if the parsed library is shared, or if the exports have
+  /// been taken. The fingerprint is only retained if #getInterfaceFingerprint
+  /// has been called before, otherwise it returns an empty string afterwards.
+  /// Must not be called concurrently with any other method of the file.
+  ///
+  /// \since 1.1
+  ///
+  void releaseParsedData() noexcept;
+
   ///
   /// \brief Obtain a list of all undefined symbols.
   /// \return Returns a list of to all undefined symbols.
@@ -336,6 +1084,71 @@ public:
   ///
   const std::vector<Symbol> &undefineds() const noexcept;
 
+  ///
+  /// \brief Take the list of all exported symbols.
+  ///
+  /// Moves the list out of the file without copying it, which is only
+  /// possible if the file owns the list and the lookups don't depend on it.
+  /// That is the case when the parsed library isn't shared with the cache or
+  /// other files, or when $ld$ directives changed the exports, unless
+  /// #releaseParsedData has already released the parsed library. The lookups
+  /// keep using the parsed library, which is then never released. Afterwards
+  /// #exports returns an empty list. Symbol lookups and #visitExports are not
+  /// affected.
+  ///
+  /// Use #visitExports when the list can't be taken.
+  ///
+  /// \param[out] exports holds the list of all exported symbols when the
+  ///             return value is true.
+  /// \return Returns false if the list is shared with other files or needed
+  ///         for the lookups.
+  /// \since 1.1
+  ///
+  bool takeExports(std::vector<Symbol> &exports) noexcept;
+
+  ///
+  /// \brief Take the list of all undefined symbols.
+  ///
+  /// Moves the list out of the file without copying it, which is only
+  /// possible if the parsed library isn't shared with the cache or other files.
+  /// Afterwards #undefineds returns an empty list and #visitUndefineds visits
+  /// no symbols.
+  ///
+  /// Use #visitUndefineds when the list can't be taken.
+  ///
+  /// \param[out] undefineds holds the list of all undefined symbols when the
+  ///             return value is true.
+  /// \return Returns false if the list is shared with other files.
+  /// \since 1.1
+  ///
+  bool takeUndefineds(std::vector<Symbol> &undefineds) noexcept;
+
+  ///
+  /// \brief Visit all exported symbols.
+  ///
+  /// Calls the visitor once for every symbol that #exports would return,
+  /// directly from the parsed file and without materializing the list or
+  /// allocating memory per symbol. The symbols are visited in no particular
+  /// order.
+  ///
+  /// \param[in] visitor the callback to call for every symbol.
+  /// \since 1.1
+  ///
+  void visitExports(const SymbolVisitor &visitor) const noexcept;
+
+  ///
+  /// \brief Visit all undefined symbols.
+  ///
+  /// Calls the visitor once for every symbol that #undefineds would return,
+  /// directly from the parsed file and without materializing the list or
+  /// allocating memory per symbol. The symbols are visited in no particular
+  /// order.
+  ///
+  /// \param[in] visitor the callback to call for every symbol.
+  /// \since 1.1
+  ///
+  void visitUndefineds(const SymbolVisitor &visitor) const noexcept;
+
   ///
   /// \brief Destructor.
   /// \since 1.0
@@ -12,7 +12,6 @@
 ///
 //===----------------------------------------------------------------------===//
 
-#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Support/Format.h"
@@ -32,32 +31,20 @@ void PackedVersion::print(raw_ostream &os) const {
 bool PackedVersion::parse32(StringRef str) {
   _version = 0;
 
-  if (str.empty())
+  auto parts = splitVersion(str);
+  if (parts.count == 0 || parts.count > 3)
     return false;
 
-  SmallVector<StringRef, 3> parts;
-  SplitString(str, parts, ".");
-
-  if (parts.size() > 3)
-    return false;
-
-  unsigned long long num;
-  if (getAsUnsignedInteger(parts[0], 10, num))
-    return false;
-
-  if (num > UINT16_MAX)
+  if (parts.values[0] > UINT16_MAX)
     return false;
 
-  _version = num << 16;
-
-  for (unsigned i = 1, shiftNum = 8; i < parts.size(); ++i, shiftNum -= 8) {
-    if (getAsUnsignedInteger(parts[i], 10, num))
-      return false;
+  _version = parts.values[0] << 16;
 
-    if (num > UINT8_MAX)
+  for (unsigned i = 1, shiftNum = 8; i < parts.count; ++i, shiftNum -= 8) {
+    if (parts.values[i] > UINT8_MAX)
       return false;
 
-    _version |= (num << shiftNum);
+    _version |= (parts.values[i] << shiftNum);
   }
 
   return true;
@@ -67,19 +54,11 @@ std::pair<bool, bool> PackedVersion::parse64(StringRef str) {
   bool truncated = false;
   _version = 0;
 
-  if (str.empty())
-    return std::make_pair(false, truncated);
-
-  SmallVector<StringRef, 5> parts;
-  SplitString(str, parts, ".");
-
-  if (parts.size() > 5)
-    return std::make_pair(false, truncated);
-
-  unsigned long long num;
-  if (getAsUnsignedInteger(parts[0], 10, num))
+  auto parts = splitVersion(str);
+  if (parts.count == 0 || parts.count > 5)
     return std::make_pair(false, truncated);
 
+  auto num = parts.values[0];
   if (num > 0xFFFFFFULL)
     return std::make_pair(false, truncated);
 
@@ -89,11 +68,9 @@ std::pair<bool, bool> PackedVersion::parse64(StringRef str) {
   }
   _version = num << 16;
 
-  for (unsigned i = 1, shiftNum = 8; i < parts.size() && i < 3;
+  for (unsigned i = 1, shiftNum = 8; i < parts.count && i < 3;
        ++i, shiftNum -= 8) {
-    if (getAsUnsignedInteger(parts[i], 10, num))
-      return std::make_pair(false, truncated);
-
+    num = parts.values[i];
     if (num > 0x3FFULL)
       return std::make_pair(false, truncated);
 
@@ -104,7 +81,7 @@ std::pair<bool, bool> PackedVersion::parse64(StringRef str) {
     _version |= (num << shiftNum);
   }
 
-  if (parts.size() > 3)
+  if (parts.count > 3)
     truncated = true;
 
   return std::make_pair(true, truncated);
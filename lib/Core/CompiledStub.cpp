@@ -0,0 +1,467 @@
+//===- lib/Core/CompiledStub.cpp - TAPI Compiled Stub -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the reader and writer for compiled stub files.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/CompiledStub.h"
+#include "tapi/Core/ExportFilter.h"
+#include "tapi/Core/InterfaceFile.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+using namespace compiled;
+
+static const Header *getHeader(MemoryBufferRef bufferRef) {
+  auto data = bufferRef.getBuffer();
+  if (data.size() < sizeof(Header))
+    return nullptr;
+
+  const auto *header = reinterpret_cast<const Header *>(data.data());
+  if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0)
+    return nullptr;
+
+  if (header->version != CurrentVersion)
+    return nullptr;
+
+  return header;
+}
+
+namespace {
+
+/// \brief Provides bounds checked access to the content of an image.
+class ImageReader {
+public:
+  ImageReader(StringRef data, const Header &header)
+      : _data(data), _header(header) {}
+
+  bool isValid() const {
+    return isInBounds(_header.stringTableOffset, _header.stringTableSize, 1);
+  }
+
+  bool getString(const String &string, StringRef &result) const {
+    if (string.offset > _header.stringTableSize ||
+        string.size > _header.stringTableSize - string.offset)
+      return false;
+    result = _data.substr(_header.stringTableOffset + string.offset,
+                          string.size);
+    return true;
+  }
+
+  template <typename T> ArrayRef<T> getTable(const Table &table) const {
+    if (!isInBounds(table.offset, table.count, sizeof(T)))
+      return None;
+    const auto *begin =
+        reinterpret_cast<const T *>(_data.data() + table.offset);
+    return makeArrayRef(begin, table.count);
+  }
+
+  template <typename T> bool isValidTable(const Table &table) const {
+    return table.count == 0 || isInBounds(table.offset, table.count, sizeof(T));
+  }
+
+private:
+  bool isInBounds(uint64_t offset, uint64_t count, uint64_t size) const {
+    return offset <= _data.size() && count * size <= _data.size() - offset;
+  }
+
+  StringRef _data;
+  const Header &_header;
+};
+
+/// \brief Collects the strings of the image and assigns them offsets.
+class StringTableBuilder {
+public:
+  String add(StringRef string) {
+    auto result = _offsets.insert(std::make_pair(string, _content.size()));
+    if (result.second)
+      _content.append(string.begin(), string.end());
+
+    String entry;
+    entry.offset = result.first->second;
+    entry.size = string.size();
+    return entry;
+  }
+
+  StringRef getContent() const { return _content; }
+
+private:
+  StringMap<uint32_t> _offsets;
+  std::string _content;
+};
+
+} // end anonymous namespace.
+
+static const uint32_t KnownArchitectures =
+    armv7 | armv7s | armv7k | arm64 | i386 | x86_64 | x86_64h;
+static const uint32_t KnownHeaderFlags =
+    TwoLevelNamespace | ApplicationExtensionSafe;
+static const uint32_t KnownSymbolFlags =
+    static_cast<uint32_t>(SymbolFlags::ThreadLocalValue) |
+    static_cast<uint32_t>(SymbolFlags::WeakDefined) |
+    static_cast<uint32_t>(SymbolFlags::WeakReferenced);
+
+static bool isValidArchitectures(uint32_t archs) {
+  return (archs & ~KnownArchitectures) == 0;
+}
+
+static bool isValidArch(uint32_t arch) {
+  return arch != 0 && isValidArchitectures(arch) && (arch & (arch - 1)) == 0;
+}
+
+static bool isValidSymbol(const compiled::Symbol &symbol) {
+  static const uint8_t LastType =
+      static_cast<uint8_t>(SymbolType::ObjCInstanceVariable);
+  return symbol.type <= LastType && (symbol.flags & ~KnownSymbolFlags) == 0 &&
+         isValidArchitectures(symbol.architectures);
+}
+
+bool CompiledStubReader::canRead(file_magic magic, MemoryBufferRef bufferRef,
+                                 FileType types) const {
+  if (!(types & FileType::CompiledStub))
+    return false;
+
+  return getHeader(bufferRef) != nullptr;
+}
+
+FileType CompiledStubReader::getFileType(file_magic magic,
+                                         MemoryBufferRef bufferRef) const {
+  if (getHeader(bufferRef) == nullptr)
+    return FileType::Invalid;
+
+  return FileType::CompiledStub;
+}
+
+bool CompiledStubReader::isCompiledFrom(MemoryBufferRef bufferRef,
+                                        uint64_t sourceHash,
+                                        uint64_t sourceSize) {
+  const auto *header = getHeader(bufferRef);
+  if (header == nullptr || header->sourceHash == 0)
+    return false;
+
+  return header->sourceHash == sourceHash && header->sourceSize == sourceSize;
+}
+
+ExportFilter CompiledStubReader::readExportFilter(MemoryBufferRef bufferRef) {
+  const auto *header = getHeader(bufferRef);
+  if (header == nullptr)
+    return ExportFilter();
+
+  ImageReader image(bufferRef.getBuffer(), *header);
+  if (!image.isValidTable<FilterWord>(header->exportFilter))
+    return ExportFilter();
+
+  auto words = image.getTable<FilterWord>(header->exportFilter);
+  return ExportFilter::createFromWords(
+      std::vector<uint64_t>(words.begin(), words.end()));
+}
+
+std::unique_ptr<File>
+CompiledStubReader::readFile(MemoryBufferRef memBuffer, ReadFlags readFlags,
+                             SkipFlags skipFlags) const {
+  const auto *header = getHeader(memBuffer);
+  if (header == nullptr)
+    return nullptr;
+
+  auto file = std::unique_ptr<InterfaceFile>(new InterfaceFile);
+  file->setPath(memBuffer.getBufferIdentifier());
+  file->setFileType(FileType::CompiledStub);
+
+  auto malformed = [&file](const Twine &message) {
+    file->setErrorCode(std::make_error_code(std::errc::invalid_argument));
+    file->setParsingError(("malformed compiled stub: " + message).str());
+    return std::move(file);
+  };
+
+  ImageReader image(memBuffer.getBuffer(), *header);
+  if (!image.isValid() || !image.isValidTable<compiled::UUID>(header->uuids) ||
+      !image.isValidTable<Library>(header->allowableClients) ||
+      !image.isValidTable<Library>(header->reexportedLibraries) ||
+      !image.isValidTable<compiled::Symbol>(header->exports) ||
+      !image.isValidTable<compiled::Symbol>(header->undefineds))
+    return malformed("table out of bounds");
+
+  // Files that were compiled from a text-based stub file keep its file type.
+  if (header->sourceFileType == FileType::TBD_V1 ||
+      header->sourceFileType == FileType::TBD_V2)
+    file->setFileType(static_cast<FileType>(uint32_t(header->sourceFileType)));
+
+  StringRef installName, parentUmbrella;
+  if (!image.getString(header->installName, installName) ||
+      !image.getString(header->parentUmbrella, parentUmbrella))
+    return malformed("string out of bounds");
+
+  if (header->platform > static_cast<uint32_t>(Platform::tvOS))
+    return malformed("invalid platform");
+  if (!isValidArchitectures(header->architectures))
+    return malformed("invalid architectures");
+  if (header->objcConstraint > static_cast<uint32_t>(ObjCConstraint::GC))
+    return malformed("invalid objc constraint");
+  if ((header->flags & ~KnownHeaderFlags) != 0)
+    return malformed("invalid flags");
+  // The text-based stub files can only encode the Swift versions 1 to 4.
+  if (header->swiftVersion > 4)
+    return malformed("invalid swift version");
+
+  file->setPlatform(static_cast<Platform>(uint32_t(header->platform)));
+  file->setArchitectures(ArchitectureSet(header->architectures));
+  file->setInstallName(installName.str());
+  file->setCurrentVersion(PackedVersion(header->currentVersion));
+  file->setCompatibilityVersion(PackedVersion(header->compatibilityVersion));
+  file->setSwiftVersion(header->swiftVersion);
+  file->setObjCConstraint(
+      static_cast<ObjCConstraint>(uint32_t(header->objcConstraint)));
+  file->setTwoLevelNamespace(header->flags & HeaderFlags::TwoLevelNamespace);
+  file->setApplicationExtensionSafe(header->flags &
+                                    HeaderFlags::ApplicationExtensionSafe);
+  file->setParentUmbrella(parentUmbrella.str());
+
+  // Skipped sections are read as empty tables.
+  auto getSection = [skipFlags](const Table &table, SkipFlags section) {
+    auto result = table;
+    if ((skipFlags & section) != SkipFlags::None)
+      result.count = 0;
+    return result;
+  };
+
+  for (const auto &uuid : image.getTable<compiled::UUID>(
+           getSection(header->uuids, SkipFlags::UUIDs))) {
+    if (!isValidArch(uuid.arch))
+      return malformed("invalid architecture");
+    file->addUUID(uuid.value, static_cast<Arch>(uint32_t(uuid.arch)));
+  }
+
+  for (const auto &client : image.getTable<Library>(getSection(
+           header->allowableClients, SkipFlags::AllowableClients))) {
+    StringRef name;
+    if (!image.getString(client.installName, name))
+      return malformed("string out of bounds");
+    if (!isValidArchitectures(client.architectures))
+      return malformed("invalid architectures");
+    file->addAllowableClient(name.str(),
+                             ArchitectureSet(client.architectures));
+  }
+
+  for (const auto &lib : image.getTable<Library>(header->reexportedLibraries)) {
+    StringRef name;
+    if (!image.getString(lib.installName, name))
+      return malformed("string out of bounds");
+    if (!isValidArchitectures(lib.architectures))
+      return malformed("invalid architectures");
+    file->addReexportedLibrary(name.str(), ArchitectureSet(lib.architectures));
+  }
+
+  if (readFlags == ReadFlags::Header) {
+    file->finalize();
+    return file;
+  }
+
+  // The writer emits the symbols sorted, so they are appended as they are. Any
+  // other order is rejected, because the file relies on sorted symbols.
+  auto exports = image.getTable<compiled::Symbol>(header->exports);
+  auto undefineds = image.getTable<compiled::Symbol>(
+      getSection(header->undefineds, SkipFlags::Undefineds));
+  file->reserveSymbols(exports.size(), undefineds.size());
+
+  for (const auto &symbol : exports) {
+    StringRef name;
+    if (!image.getString(symbol.name, name))
+      return malformed("string out of bounds");
+    if (!isValidSymbol(symbol))
+      return malformed("invalid symbol");
+    if (!file->appendExportedSymbol(name,
+                                    static_cast<SymbolType>(symbol.type),
+                                    static_cast<SymbolFlags>(symbol.flags),
+                                    ArchitectureSet(symbol.architectures)))
+      return malformed("symbols not sorted");
+  }
+
+  for (const auto &symbol : undefineds) {
+    StringRef name;
+    if (!image.getString(symbol.name, name))
+      return malformed("string out of bounds");
+    if (!isValidSymbol(symbol))
+      return malformed("invalid symbol");
+    if (!file->appendUndefinedSymbol(name,
+                                     static_cast<SymbolType>(symbol.type),
+                                     static_cast<SymbolFlags>(symbol.flags),
+                                     ArchitectureSet(symbol.architectures)))
+      return malformed("symbols not sorted");
+  }
+
+  file->finalize();
+  return file;
+}
+
+bool CompiledStubWriter::canWrite(const File *file) const {
+  return isa<InterfaceFile>(file) &&
+         file->getFileType() == FileType::CompiledStub;
+}
+
+std::error_code CompiledStubWriter::writeFile(const File *file) const {
+  if (file == nullptr)
+    return std::make_error_code(std::errc::invalid_argument);
+
+  std::error_code ec;
+  raw_fd_ostream out(file->getPath(), ec, sys::fs::F_None);
+  if (ec)
+    return ec;
+
+  return writeFile(out, file);
+}
+
+std::error_code CompiledStubWriter::writeFile(raw_ostream &os,
+                                              const File *file) const {
+  if (file == nullptr)
+    return std::make_error_code(std::errc::invalid_argument);
+
+  write(os, *cast<InterfaceFile>(file));
+  return std::error_code();
+}
+
+template <typename T>
+static void writeTable(raw_ostream &os, const std::vector<T> &entries) {
+  os.write(reinterpret_cast<const char *>(entries.data()),
+           entries.size() * sizeof(T));
+}
+
+void CompiledStubWriter::write(raw_ostream &os, const InterfaceFile &file,
+                               uint64_t sourceHash, uint64_t sourceSize) {
+  StringTableBuilder strings;
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = CurrentVersion;
+  if (file.getFileType() == FileType::TBD_V1 ||
+      file.getFileType() == FileType::TBD_V2)
+    header.sourceFileType = file.getFileType();
+  header.sourceHash = sourceHash;
+  header.sourceSize = sourceSize;
+  header.platform = static_cast<uint32_t>(file.getPlatform());
+  header.architectures = static_cast<uint32_t>(file.getArchitectures());
+  header.currentVersion = file.getCurrentVersion()._version;
+  header.compatibilityVersion = file.getCompatibilityVersion()._version;
+  header.swiftVersion = file.getSwiftVersion();
+  header.objcConstraint = static_cast<uint32_t>(file.getObjCConstraint());
+  uint32_t flags = 0;
+  if (file.isTwoLevelNamespace())
+    flags |= HeaderFlags::TwoLevelNamespace;
+  if (file.isApplicationExtensionSafe())
+    flags |= HeaderFlags::ApplicationExtensionSafe;
+  header.flags = flags;
+  header.installName = strings.add(file.getInstallName());
+  header.parentUmbrella = strings.add(file.getParentUmbrella());
+
+  std::vector<compiled::UUID> uuids;
+  for (const auto &uuid : file.uuids()) {
+    compiled::UUID entry;
+    entry.arch = uuid.first;
+    std::copy(uuid.second.bytes(),
+              uuid.second.bytes() + sizeof(entry.value), entry.value);
+    uuids.emplace_back(entry);
+  }
+
+  auto getLibraries = [&strings](const std::vector<InterfaceFileRef> &refs) {
+    std::vector<Library> libraries;
+    for (const auto &ref : refs) {
+      Library entry;
+      entry.installName = strings.add(ref.getInstallName());
+      entry.architectures = static_cast<uint32_t>(ref.getArchitectures());
+      libraries.emplace_back(entry);
+    }
+    return libraries;
+  };
+  auto allowableClients = getLibraries(file.allowableClients());
+  auto reexportedLibraries = getLibraries(file.reexportedLibraries());
+
+  // Only the architectures of a symbol are recorded. The text-based stub files
+  // don't carry any other availability information.
+  //
+  // The symbols are written sorted by name and type, which allows the reader to
+  // append them without sorting. The set is only sorted after finalize.
+  auto getSymbols = [&strings](const SymbolSet &symbols) {
+    std::vector<const TAPI_INTERNAL::Symbol *> sorted;
+    sorted.reserve(symbols.size());
+    for (const auto &symbol : symbols)
+      if (!symbol.isUnavailable())
+        sorted.emplace_back(&symbol);
+    auto lessThan = [](const TAPI_INTERNAL::Symbol *lhs,
+                       const TAPI_INTERNAL::Symbol *rhs) {
+      auto result = lhs->getName().compare(rhs->getName());
+      if (result != 0)
+        return result < 0;
+      return lhs->getType() < rhs->getType();
+    };
+    if (!std::is_sorted(sorted.begin(), sorted.end(), lessThan))
+      std::sort(sorted.begin(), sorted.end(), lessThan);
+
+    std::vector<compiled::Symbol> entries;
+    entries.reserve(sorted.size());
+    for (const auto *symbol : sorted) {
+      compiled::Symbol entry;
+      std::memset(&entry, 0, sizeof(entry));
+      entry.name = strings.add(symbol->getName());
+      entry.architectures =
+          static_cast<uint32_t>(symbol->getArchitectures());
+      entry.type = static_cast<uint8_t>(symbol->getType());
+      entry.flags = static_cast<uint8_t>(symbol->getFlags());
+      entries.emplace_back(entry);
+    }
+    return entries;
+  };
+  auto exports = getSymbols(file.exports());
+  auto undefineds = getSymbols(file.undefineds());
+
+  auto filter = ExportFilter::create(file.exports());
+  std::vector<FilterWord> filterWords(filter.getWords().begin(),
+                                      filter.getWords().end());
+
+  uint32_t offset = sizeof(Header);
+  auto layout = [&offset](Table &table, size_t count, size_t size) {
+    table.offset = offset;
+    table.count = count;
+    offset += count * size;
+  };
+  layout(header.uuids, uuids.size(), sizeof(compiled::UUID));
+  layout(header.allowableClients, allowableClients.size(), sizeof(Library));
+  layout(header.reexportedLibraries, reexportedLibraries.size(),
+         sizeof(Library));
+  layout(header.exports, exports.size(), sizeof(compiled::Symbol));
+  layout(header.undefineds, undefineds.size(), sizeof(compiled::Symbol));
+  layout(header.exportFilter, filterWords.size(), sizeof(FilterWord));
+  header.stringTableOffset = offset;
+  header.stringTableSize = strings.getContent().size();
+
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  writeTable(os, uuids);
+  writeTable(os, allowableClients);
+  writeTable(os, reexportedLibraries);
+  writeTable(os, exports);
+  writeTable(os, undefineds);
+  writeTable(os, filterWords);
+  os << strings.getContent();
+}
+
+std::string getCompiledStubPath(StringRef path) {
+  SmallString<128> compiledPath(path);
+  sys::path::replace_extension(compiledPath, ".tbdc");
+  return compiledPath.str();
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,71 @@
+//===- lib/Core/ExportFilter.cpp - Exported Symbol Filter -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the Bloom filter over exported symbol names.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/ExportFilter.h"
+#include "tapi/Core/SymbolSet.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// Ten bits per name and six probes give a false positive rate of about one
+/// percent.
+static const unsigned bitsPerName = 10;
+static const unsigned numProbes = 6;
+
+/// \brief Call the callback with the bit index of every probe for the name.
+///
+/// The probes are derived from one hash by double hashing. The hash has to be
+/// stable across processes, because filters are stored in compiled stubs.
+template <typename Fn>
+static void forEachProbe(StringRef name, uint64_t mask, Fn callback) {
+  auto hash = xxHash64(name);
+  auto step = (hash >> 32) | 1;
+  for (unsigned i = 0; i < numProbes; ++i, hash += step)
+    callback(hash & mask);
+}
+
+ExportFilter ExportFilter::create(const SymbolSet &symbols) {
+  auto numBits =
+      std::max<uint64_t>(64, NextPowerOf2(symbols.size() * bitsPerName));
+  ExportFilter filter;
+  filter._words.resize(numBits / 64);
+  for (const auto &symbol : symbols)
+    forEachProbe(symbol.getName(), numBits - 1, [&filter](uint64_t bit) {
+      filter._words[bit / 64] |= UINT64_C(1) << (bit % 64);
+    });
+  return filter;
+}
+
+ExportFilter ExportFilter::createFromWords(std::vector<uint64_t> words) {
+  ExportFilter filter;
+  if (isPowerOf2_64(words.size()))
+    filter._words = std::move(words);
+  return filter;
+}
+
+bool ExportFilter::mayContain(StringRef name) const {
+  if (_words.empty())
+    return true;
+
+  bool result = true;
+  forEachProbe(name, _words.size() * 64 - 1, [&](uint64_t bit) {
+    result &= (_words[bit / 64] >> (bit % 64)) & 1;
+  });
+  return result;
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,112 @@
+//===- lib/Core/Fingerprint.cpp - TAPI Fingerprint --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the 128-bit fingerprint.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/Fingerprint.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief The finalizer of MurmurHash3, which spreads every input bit over the
+/// whole value.
+static uint64_t mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/// \brief MurmurHash64A, which is independent of the xxHash64 of the low lane.
+static uint64_t murmurHash64(StringRef data, uint64_t seed) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const unsigned r = 47;
+
+  uint64_t hash = seed ^ (data.size() * m);
+  const auto *it = reinterpret_cast<const uint8_t *>(data.data());
+  const auto *end = it + (data.size() & ~size_t(7));
+  for (; it != end; it += 8) {
+    uint64_t k = support::endian::read64le(it);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    hash ^= k;
+    hash *= m;
+  }
+
+  switch (data.size() & 7) {
+  case 7:
+    hash ^= uint64_t(it[6]) << 48;
+    LLVM_FALLTHROUGH;
+  case 6:
+    hash ^= uint64_t(it[5]) << 40;
+    LLVM_FALLTHROUGH;
+  case 5:
+    hash ^= uint64_t(it[4]) << 32;
+    LLVM_FALLTHROUGH;
+  case 4:
+    hash ^= uint64_t(it[3]) << 24;
+    LLVM_FALLTHROUGH;
+  case 3:
+    hash ^= uint64_t(it[2]) << 16;
+    LLVM_FALLTHROUGH;
+  case 2:
+    hash ^= uint64_t(it[1]) << 8;
+    LLVM_FALLTHROUGH;
+  case 1:
+    hash ^= uint64_t(it[0]);
+    hash *= m;
+  }
+
+  hash ^= hash >> r;
+  hash *= m;
+  hash ^= hash >> r;
+  return hash;
+}
+
+Fingerprint Fingerprint::get(StringRef name) {
+  Fingerprint result;
+  result.low = xxHash64(name);
+  result.high = murmurHash64(name, 0x9e3779b97f4a7c15ULL);
+  return result;
+}
+
+Fingerprint Fingerprint::withAttributes(uint64_t attributes) const {
+  Fingerprint result;
+  result.low = mix(low + mix(attributes));
+  result.high = mix(high ^ mix(attributes ^ 0x5851f42d4c957f2dULL));
+  return result;
+}
+
+Fingerprint Fingerprint::finalize() const {
+  Fingerprint result;
+  result.low = mix(low ^ mix(high));
+  result.high = mix(high + result.low);
+  return result;
+}
+
+std::string Fingerprint::str() const {
+  static const char digits[] = "0123456789abcdef";
+  std::string result(32, '0');
+  for (unsigned i = 0; i < 16; ++i) {
+    result[15 - i] = digits[(high >> (4 * i)) & 0xf];
+    result[31 - i] = digits[(low >> (4 * i)) & 0xf];
+  }
+  return result;
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,201 @@
+//===- lib/Core/Instrumentation.cpp - Hot Path Instrumentation --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the process-wide timings and counters.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/Instrumentation.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+constexpr unsigned Instrumentation::NumPhases;
+constexpr unsigned Instrumentation::NumCounters;
+
+std::atomic<bool> Instrumentation::_enabled(false);
+
+static std::atomic<uint64_t> times[Instrumentation::NumPhases];
+static std::atomic<uint64_t> counters[Instrumentation::NumCounters];
+
+struct Instrumentation::TraceRecord {
+  TraceRecord() {
+    for (auto &time : times)
+      time.store(0, std::memory_order_relaxed);
+    for (auto &counter : counters)
+      counter.store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> times[Instrumentation::NumPhases];
+  std::atomic<uint64_t> counters[Instrumentation::NumCounters];
+};
+
+/// \brief The trace the current thread records into.
+static thread_local Instrumentation::TraceRecord *currentTrace = nullptr;
+
+static double toMilliseconds(uint64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1e6;
+}
+
+static void printSummary() {
+  errs() << "tapi statistics:\n";
+  for (unsigned i = 0; i < Instrumentation::NumCounters; ++i) {
+    auto counter = static_cast<Instrumentation::Counter>(i);
+    errs() << "  " << Instrumentation::getName(counter) << ": "
+           << Instrumentation::get(counter) << "\n";
+  }
+  for (unsigned i = 0; i < Instrumentation::NumPhases; ++i) {
+    auto phase = static_cast<Instrumentation::Phase>(i);
+    errs() << "  " << Instrumentation::getName(phase) << ": "
+           << format("%.3f ms", toMilliseconds(Instrumentation::getTime(phase)))
+           << "\n";
+  }
+}
+
+/// \brief Reads the environment on first use and registers the summary to be
+/// printed at exit when tracing.
+static bool isTracing() {
+  static const bool tracing = [] {
+    auto tracing = std::getenv("TAPI_TRACE") != nullptr;
+    if (tracing || std::getenv("TAPI_STATISTICS") != nullptr)
+      Instrumentation::setEnabled(true);
+
+    // Construct the stream before registering the handler, so that it outlives
+    // the summary.
+    if (tracing) {
+      errs();
+      std::atexit(printSummary);
+    }
+    return tracing;
+  }();
+  return tracing;
+}
+
+void Instrumentation::initialize() { isTracing(); }
+
+void Instrumentation::setEnabled(bool enabled) {
+  _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Instrumentation::addTime(Phase phase, uint64_t nanoseconds) {
+  auto index = static_cast<unsigned>(phase);
+  times[index].fetch_add(nanoseconds, std::memory_order_relaxed);
+  if (auto *trace = currentTrace)
+    trace->times[index].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void Instrumentation::add(Counter counter, uint64_t value) {
+  if (!isEnabled())
+    return;
+
+  auto index = static_cast<unsigned>(counter);
+  counters[index].fetch_add(value, std::memory_order_relaxed);
+  if (auto *trace = currentTrace)
+    trace->counters[index].fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::getTime(Phase phase) {
+  return times[static_cast<unsigned>(phase)].load(std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::get(Counter counter) {
+  return counters[static_cast<unsigned>(counter)].load(
+      std::memory_order_relaxed);
+}
+
+void Instrumentation::reset() {
+  for (auto &time : times)
+    time.store(0, std::memory_order_relaxed);
+  for (auto &counter : counters)
+    counter.store(0, std::memory_order_relaxed);
+}
+
+StringRef Instrumentation::getName(Phase phase) {
+  switch (phase) {
+  case Phase::Copy:
+    return "copy";
+  case Phase::Parse:
+    return "parse";
+  case Phase::Denormalize:
+    return "denormalize";
+  case Phase::Projection:
+    return "projection";
+  case Phase::Sort:
+    return "sort";
+  case Phase::LinkerDirectives:
+    return "linker-directives";
+  case Phase::ReadBinary:
+    return "read-binary";
+  }
+  llvm_unreachable("unknown phase");
+}
+
+StringRef Instrumentation::getName(Counter counter) {
+  switch (counter) {
+  case Counter::FilesCreated:
+    return "files-created";
+  case Counter::TextFilesRead:
+    return "text-files-read";
+  case Counter::BinaryFilesRead:
+    return "binary-files-read";
+  case Counter::BytesRead:
+    return "bytes-read";
+  case Counter::SymbolsRead:
+    return "symbols-read";
+  }
+  llvm_unreachable("unknown counter");
+}
+
+Instrumentation::Trace::Trace(StringRef path) : _path(path) {
+  if (currentTrace != nullptr || !isTracing() || !isEnabled())
+    return;
+
+  _record.reset(new TraceRecord);
+  currentTrace = _record.get();
+}
+
+Instrumentation::Trace::~Trace() {
+  if (!_record)
+    return;
+  currentTrace = nullptr;
+
+  std::string line;
+  raw_string_ostream os(line);
+  os << "tapi trace: " << _path;
+  for (unsigned i = 0; i < NumPhases; ++i)
+    os << " " << getName(static_cast<Phase>(i)) << "="
+       << format("%.3fms", toMilliseconds(_record->times[i].load(
+                               std::memory_order_relaxed)));
+  for (unsigned i = 0; i < NumCounters; ++i)
+    os << " " << getName(static_cast<Counter>(i)) << "="
+       << _record->counters[i].load(std::memory_order_relaxed);
+  os << "\n";
+
+  // Write the line at once, so that concurrent traces don't interleave.
+  errs() << os.str();
+}
+
+Instrumentation::TraceRecord *Instrumentation::getCurrentTrace() {
+  return currentTrace;
+}
+
+Instrumentation::TraceScope::TraceScope(TraceRecord *record)
+    : _previous(currentTrace) {
+  currentTrace = record;
+}
+
+Instrumentation::TraceScope::~TraceScope() { currentTrace = _previous; }
+
+TAPI_NAMESPACE_INTERNAL_END
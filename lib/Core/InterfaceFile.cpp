@@ -13,38 +13,56 @@
 //===----------------------------------------------------------------------===//
 
 #include "tapi/Core/InterfaceFile.h"
-#include "llvm/ADT/SmallString.h"
-#include <iomanip>
-#include <sstream>
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
-bool InterfaceFile::removeExportedSymbol(const std::string &name,
-                                         SymbolType type) {
-  auto it = _exports.find(std::make_pair(name, type));
-  if (it == _exports.end())
-    return false;
+InterfaceFile::~InterfaceFile() {
+  // The symbol names dominate the strings of a file.
+  _pool->release(_exports.getNameBytes() + _undefineds.getNameBytes());
+}
 
-  _exports.erase(it);
-  return true;
+static void addSymbol(SymbolSet &symbols, StringRef name, SymbolType type,
+                      SymbolFlags flags, ArchitectureSet archs) {
+  auto *symbol = symbols.insert(name, type, flags).first;
+  symbol->addArchitectures(archs);
+}
+
+void InterfaceFile::addExportedSymbol(StringRef name, SymbolType type,
+                                      SymbolFlags flags,
+                                      ArchitectureSet archs) {
+  assertMutable();
+  addSymbol(_exports, name, type, flags, archs);
+}
+
+void InterfaceFile::addUndefinedSymbol(StringRef name, SymbolType type,
+                                       SymbolFlags flags,
+                                       ArchitectureSet archs) {
+  assertMutable();
+  addSymbol(_undefineds, name, type, flags, archs);
+}
+
+bool InterfaceFile::removeExportedSymbol(StringRef name, SymbolType type) {
+  assertMutable();
+  return _exports.erase(name, type);
 }
 
-bool InterfaceFile::removeExportedSymbol(const std::string &name,
-                                         SymbolType type,
+bool InterfaceFile::removeExportedSymbol(StringRef name, SymbolType type,
                                          ArchitectureSet archs) {
-  auto it = _exports.find(std::make_pair(name, type));
-  if (it == _exports.end())
+  assertMutable();
+  auto *symbol = _exports.find(name, type);
+  if (symbol == nullptr)
     return false;
 
   for (const auto arch : archs)
-    it->second.removeArch(arch);
+    symbol->removeArch(arch);
 
-  if (it->second.getArchitectures().empty())
-    _exports.erase(it);
+  if (symbol->getArchitectures().empty())
+    _exports.erase(name, type);
   return true;
 }
 
 bool InterfaceFile::removeReexportedLibrary(StringRef installName) {
+  assertMutable();
   auto it = remove_if(_reexportedLibraries,
                       [&installName](const InterfaceFileRef &ref) {
                         return ref.getInstallName() == installName;
@@ -57,23 +75,88 @@ bool InterfaceFile::removeReexportedLibrary(StringRef installName) {
   return true;
 }
 
-void InterfaceFile::addUUID(uint8_t uuid[16], Arch arch) {
-  std::stringstream stream;
-  for (unsigned i = 0; i < 16; ++i) {
-    if (i == 4 || i == 6 || i == 8 || i == 10)
-      stream << '-';
-    stream << std::setfill('0') << std::setw(2) << std::uppercase << std::hex
-           << static_cast<int>(uuid[i]);
+namespace {
+/// \brief The kind of an entry of the fingerprint and the content digest.
+enum class EntryKind : uint64_t {
+  Export = 1,
+  Undefined = 2,
+  ReexportedLibrary = 3,
+  AllowableClient = 4,
+  InstallName = 5,
+  CurrentVersion = 6,
+  CompatibilityVersion = 7,
+};
+} // end anonymous namespace.
+
+static uint64_t getAttributes(EntryKind kind, uint64_t attributes) {
+  return static_cast<uint64_t>(kind) << 56 | attributes;
+}
+
+/// \brief The attributes of a symbol, except for its architectures.
+static uint64_t getSymbolAttributes(EntryKind kind, const Symbol &symbol) {
+  return getAttributes(kind,
+                       static_cast<uint64_t>(symbol.getType()) << 40 |
+                           static_cast<uint64_t>(symbol.getFlags()) << 32);
+}
+
+Fingerprint InterfaceFile::getFingerprint() const {
+  // Every architecture of a symbol or library is an entry of its own, so the
+  // fingerprint doesn't depend on how the file format groups architectures.
+  Fingerprint fingerprint;
+  for (const auto &symbol : _exports) {
+    auto name = Fingerprint::get(symbol.getName());
+    auto attributes = getSymbolAttributes(EntryKind::Export, symbol);
+    for (auto arch : symbol.getArchitectures())
+      fingerprint += name.withAttributes(attributes | arch);
   }
-  addUUID(arch, stream.str());
+  for (const auto &library : _reexportedLibraries) {
+    auto name = Fingerprint::get(library.getInstallName());
+    auto attributes = getAttributes(EntryKind::ReexportedLibrary, 0);
+    for (auto arch : library.getArchitectures())
+      fingerprint += name.withAttributes(attributes | arch);
+  }
+
+  fingerprint += Fingerprint::get(_installName)
+                     .withAttributes(getAttributes(EntryKind::InstallName, 0));
+  fingerprint += Fingerprint().withAttributes(
+      getAttributes(EntryKind::CurrentVersion, _currentVersion._version));
+  fingerprint += Fingerprint().withAttributes(getAttributes(
+      EntryKind::CompatibilityVersion, _compatibilityVersion._version));
+  return fingerprint.finalize();
+}
+
+uint64_t InterfaceFile::getContentDigest() const {
+  // The entries are combined by addition, so their order doesn't matter.
+  Fingerprint digest;
+  for (const auto &symbol : _exports)
+    digest += Fingerprint::get(symbol.getName())
+                  .withAttributes(
+                      getSymbolAttributes(EntryKind::Export, symbol) |
+                      static_cast<uint32_t>(symbol.getArchitectures()));
+  for (const auto &symbol : _undefineds)
+    digest += Fingerprint::get(symbol.getName())
+                  .withAttributes(
+                      getSymbolAttributes(EntryKind::Undefined, symbol) |
+                      static_cast<uint32_t>(symbol.getArchitectures()));
+  for (const auto &library : _reexportedLibraries)
+    digest += Fingerprint::get(library.getInstallName())
+                  .withAttributes(getAttributes(
+                      EntryKind::ReexportedLibrary,
+                      static_cast<uint32_t>(library.getArchitectures())));
+  for (const auto &client : _allowableClients)
+    digest += Fingerprint::get(client.getInstallName())
+                  .withAttributes(getAttributes(
+                      EntryKind::AllowableClient,
+                      static_cast<uint32_t>(client.getArchitectures())));
+  return digest.finalize().low;
 }
 
 bool InterfaceFile::contains(const Symbol &symbol, Symbol &result) const {
-  auto it = _exports.find(std::make_pair(symbol.getName(), symbol.getType()));
-  if (it == _exports.end())
+  const auto *found = _exports.find(symbol.getName(), symbol.getType());
+  if (found == nullptr)
     return false;
 
-  result = it->second;
+  result = *found;
   return true;
 }
 
@@ -0,0 +1,125 @@
+//===- lib/Core/InterfaceFileCache.cpp - Interface File Cache ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the interface file cache.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/InterfaceFileCache.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+uint64_t InterfaceFileCache::computeHash(StringRef content) {
+  return xxHash64(content);
+}
+
+InterfaceFileCache::Key InterfaceFileCache::Key::get(StringRef content) {
+  Key key;
+  key.hash = computeHash(content);
+  key.check = hash_value(content);
+  key.size = content.size();
+  return key;
+}
+
+InterfaceFileCache::FilePtr
+InterfaceFileCache::lookup(StringRef path, const Key &key,
+                           SkipFlags skipFlags) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_capacity == 0)
+    return nullptr;
+
+  auto it = _index.find(path);
+  if (it == _index.end() || it->second->key != key ||
+      (it->second->skipFlags | skipFlags) != skipFlags) {
+    ++_stats.misses;
+    return nullptr;
+  }
+
+  // Move the entry to the front of the LRU list.
+  _entries.splice(_entries.begin(), _entries, it->second);
+  ++_stats.hits;
+  return it->second->file;
+}
+
+void InterfaceFileCache::insertAlias(StringRef alias, StringRef path) {
+  FilePtr file;
+  Key key;
+  SkipFlags skipFlags;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(path);
+    if (it == _index.end())
+      return;
+    key = it->second->key;
+    file = it->second->file;
+    skipFlags = it->second->skipFlags;
+  }
+  insert(alias, key, std::move(file), skipFlags);
+}
+
+void InterfaceFileCache::insert(StringRef path, const Key &key, FilePtr file,
+                                SkipFlags skipFlags) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_capacity == 0 || file == nullptr)
+    return;
+
+  auto it = _index.find(path);
+  if (it != _index.end()) {
+    // Replace the stale entry for this path.
+    auto &entry = *it->second;
+    entry.key = key;
+    entry.file = std::move(file);
+    entry.skipFlags = skipFlags;
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return;
+  }
+
+  evict(_capacity - 1);
+  _entries.push_front(Entry{path.str(), key, std::move(file), skipFlags});
+  _index[path] = _entries.begin();
+}
+
+void InterfaceFileCache::evict(size_t capacity) {
+  while (_entries.size() > capacity) {
+    _index.erase(_entries.back().path);
+    _entries.pop_back();
+    ++_stats.evictions;
+  }
+}
+
+void InterfaceFileCache::setCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _capacity = capacity;
+  evict(capacity);
+}
+
+size_t InterfaceFileCache::getCapacity() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _capacity;
+}
+
+void InterfaceFileCache::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _index.clear();
+  _entries.clear();
+}
+
+InterfaceFileCache::Statistics InterfaceFileCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto stats = _stats;
+  stats.entries = _entries.size();
+  return stats;
+}
+
+TAPI_NAMESPACE_INTERNAL_END
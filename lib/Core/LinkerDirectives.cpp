@@ -0,0 +1,111 @@
+//===- lib/Core/LinkerDirectives.cpp - TAPI Linker Directives ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the parsing of the $ld$ linker directives.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/LinkerDirectives.h"
+#include "tapi/Core/Instrumentation.h"
+#include "tapi/Core/InterfaceFile.h"
+#include "llvm/ADT/StringSwitch.h"
+#include <algorithm>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+PackedVersion32 LinkerDirectives::parseVersion(StringRef str) {
+  // Components after the subminor version are ignored.
+  auto parts = splitVersion(str);
+  if (parts.count == 0 || parts.values[0] > UINT16_MAX)
+    return 0;
+
+  uint32_t version = parts.values[0] << 16;
+  for (unsigned i = 1, shiftNum = 8; i < parts.count && i < 3;
+       ++i, shiftNum -= 8) {
+    if (parts.values[i] > UINT8_MAX)
+      return 0;
+
+    version |= (parts.values[i] << shiftNum);
+  }
+
+  return version;
+}
+
+LinkerDirectives::LinkerDirectives(const InterfaceFile &file) {
+  Instrumentation::Timer timer(Instrumentation::Phase::LinkerDirectives);
+
+  // The exports are sorted by name, so the directives are all next to each
+  // other.
+  const auto &exports = file.exports();
+  auto it = std::lower_bound(exports.begin(), exports.end(), "$ld$",
+                             [](const Symbol &symbol, StringRef name) {
+                               return symbol.getName() < name;
+                             });
+  for (auto ie = exports.end(); it != ie; ++it) {
+    auto name = it->getName();
+    if (!name.startswith("$ld$"))
+      break;
+
+    if (!it->isSymbol() || it->isUnavailable())
+      continue;
+
+    // $ld$ <action> $ <condition> $ <symbol-name>
+    StringRef action, condition, symbolName, rest;
+    std::tie(action, rest) = name.drop_front(4).split('$');
+    std::tie(condition, symbolName) = rest.split('$');
+    if (action.empty() || condition.empty() || symbolName.empty())
+      continue;
+
+    if (!condition.startswith("os"))
+      continue;
+
+    Directive directive;
+    directive.osVersion = parseVersion(condition.drop_front(2));
+    directive.action = StringSwitch<Action>(action)
+                           .Case("hide", Action::Hide)
+                           .Case("add", Action::Add)
+                           .Case("install_name", Action::InstallName)
+                           .Case("compatibility_version",
+                                 Action::CompatibilityVersion)
+                           .Default(Action::Unknown);
+    directive.flags = it->getFlags();
+    directive.archs = it->getArchitectures();
+    directive.name = directive.action == Action::Unknown ? name : symbolName;
+    directive.version = directive.action == Action::CompatibilityVersion
+                            ? parseVersion(symbolName)
+                            : PackedVersion32(0);
+    _directives.emplace_back(directive);
+  }
+
+  std::stable_sort(_directives.begin(), _directives.end(),
+                   [](const Directive &lhs, const Directive &rhs) {
+                     return lhs.osVersion < rhs.osVersion;
+                   });
+}
+
+ArrayRef<LinkerDirectives::Directive>
+LinkerDirectives::lookup(PackedVersion32 osVersion) const {
+  auto begin = std::lower_bound(
+      _directives.begin(), _directives.end(), osVersion,
+      [](const Directive &lhs, PackedVersion32 rhs) {
+        return lhs.osVersion < rhs;
+      });
+  auto end = std::upper_bound(
+      begin, _directives.end(), osVersion,
+      [](PackedVersion32 lhs, const Directive &rhs) {
+        return lhs < rhs.osVersion;
+      });
+  return makeArrayRef(_directives.data() + (begin - _directives.begin()),
+                      end - begin);
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -14,7 +14,9 @@
 
 #include "tapi/Core/MachODylibReader.h"
 #include "tapi/Core/ArchitectureSupport.h"
+#include "tapi/Core/Instrumentation.h"
 #include "tapi/Core/InterfaceFile.h"
+#include "tapi/Core/Parallel.h"
 #include "llvm/BinaryFormat/Magic.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Support/Endian.h"
@@ -105,9 +107,36 @@ static std::tuple<StringRef, SymbolType> parseSymbol(StringRef symbolName) {
   return std::make_tuple(name, type);
 }
 
-void load(MachOObjectFile *object, InterfaceFile *file) {
+/// \brief The number of symbols in all slices from which on the slices are
+/// read concurrently.
+static const uint64_t parallelSymbolThreshold = 16384;
+
+namespace {
+
+/// \brief A dylib slice of the binary and the symbols read from it.
+///
+/// The symbols are interned in the string pool of the file they are merged
+/// into.
+struct Slice {
+  Slice(MachOObjectFile *object, StringPool &pool)
+      : object(object), exports(pool), undefineds(pool) {}
+
+  MachOObjectFile *object;
+  Arch arch = Arch::unknown;
+  bool readUndefineds = false;
+  SymbolSet exports;
+  SymbolSet undefineds;
+};
+
+} // end anonymous namespace.
+
+/// \brief Read everything but the symbols of the slice into the file.
+static void loadHeader(Slice &slice, InterfaceFile *file,
+                       SkipFlags skipFlags) {
+  auto *object = slice.object;
   auto H = object->getHeader();
   auto arch = getArchType(H.cputype, H.cpusubtype);
+  slice.arch = arch;
   file->setArch(arch);
   auto fileType = H.filetype == MachO::MH_DYLIB
                       ? FileType::MachO_DynamicLibrary
@@ -134,11 +163,15 @@ void load(MachOObjectFile *object, InterfaceFile *file) {
       break;
     }
     case MachO::LC_SUB_CLIENT: {
+      if ((skipFlags & SkipFlags::AllowableClients) != SkipFlags::None)
+        break;
       auto SCLC = object->getSubClientCommand(LCI);
       file->addAllowableClient(LCI.Ptr + SCLC.client, arch);
       break;
     }
     case MachO::LC_UUID: {
+      if ((skipFlags & SkipFlags::UUIDs) != SkipFlags::None)
+        break;
       auto UUIDLC = object->getUuidCommand(LCI);
       file->addUUID(UUIDLC.uuid, arch);
       break;
@@ -166,6 +199,13 @@ void load(MachOObjectFile *object, InterfaceFile *file) {
   if (H.flags & MachO::MH_APP_EXTENSION_SAFE)
     file->setApplicationExtensionSafe();
 
+  // Only record undef symbols for flat namespace dylibs.
+  slice.readUndefineds = !file->isTwoLevelNamespace() &&
+                         (skipFlags & SkipFlags::Undefineds) == SkipFlags::None;
+}
+
+/// \brief Read the ObjC image info of the slice into the file.
+static void loadImageInfo(MachOObjectFile *object, InterfaceFile *file) {
   for (auto &section : object->sections()) {
     StringRef sectionName;
     section.getName(sectionName);
@@ -196,7 +236,14 @@ void load(MachOObjectFile *object, InterfaceFile *file) {
       file->setSwiftVersion(((flags >> 8) & 0xFF));
     }
   }
+}
 
+/// \brief Read the symbols of the slice into the symbol sets of the slice.
+///
+/// This doesn't touch the interface file and can run concurrently for
+/// different slices.
+static void loadSymbols(Slice &slice) {
+  auto *object = slice.object;
   for (const auto &symbol : object->exports()) {
     StringRef name;
     SymbolType type;
@@ -211,11 +258,10 @@ void load(MachOObjectFile *object, InterfaceFile *file) {
       flags = SymbolFlags::ThreadLocalValue;
       break;
     }
-    file->addExportedSymbol(name.str(), type, flags, arch);
+    slice.exports.insert(name, type, flags);
   }
 
-  // Only record undef symbols for flat namespace dylibs.
-  if (file->isTwoLevelNamespace())
+  if (!slice.readUndefineds)
     return;
 
   for (const auto &symbol : object->symbols()) {
@@ -235,50 +281,95 @@ void load(MachOObjectFile *object, InterfaceFile *file) {
     StringRef name;
     SymbolType type;
     std::tie(name, type) = parseSymbol(symbolName.get());
-    file->addUndefinedSymbol(name.str(), type, flags, arch);
+    slice.undefineds.insert(name, type, flags);
   }
 }
 
 std::unique_ptr<File>
-MachODylibReader::readFile(MemoryBufferRef memBuffer) const {
+MachODylibReader::readFile(MemoryBufferRef memBuffer, ReadFlags readFlags,
+                           SkipFlags skipFlags) const {
+  Instrumentation::Timer timer(Instrumentation::Phase::ReadBinary);
   auto file = std::unique_ptr<InterfaceFile>(new InterfaceFile);
   file->setPath(memBuffer.getBufferIdentifier());
 
   auto binaryOrErr = createBinary(memBuffer);
   if (auto ec = binaryOrErr.takeError()) {
     file->setErrorCode(std::make_error_code(std::errc::invalid_argument));
-    return std::move(file);
+    return file;
   }
 
+  std::vector<std::unique_ptr<MachOObjectFile>> objects;
+  std::vector<Slice> slices;
   Binary &binary = *binaryOrErr.get();
-  if (auto *object = dyn_cast<MachOObjectFile>(&binary)) {
-    load(object, file.get());
-    return std::move(file);
+  if (auto *object = dyn_cast<MachOObjectFile>(&binary))
+    slices.emplace_back(object, file->getStringPool());
+  else {
+    // Only expecting MachO universal binaries at this point.
+    assert(isa<MachOUniversalBinary>(&binary) &&
+           "Expected a MachO universal binary.");
+    auto *UB = cast<MachOUniversalBinary>(&binary);
+    for (auto OI = UB->begin_objects(), OE = UB->end_objects(); OI != OE;
+         ++OI) {
+      auto objOrErr = OI->getAsObjectFile();
+
+      // Ignore archives.
+      if (!objOrErr)
+        continue;
+
+      auto &object = *objOrErr.get();
+      switch (object.getHeader().filetype) {
+      default:
+        break;
+      case MachO::MH_DYLIB:
+      case MachO::MH_DYLIB_STUB:
+        slices.emplace_back(&object, file->getStringPool());
+        objects.emplace_back(std::move(objOrErr.get()));
+        break;
+      }
+    }
   }
 
-  // Only expecting MachO universal binaries at this point.
-  assert(isa<MachOUniversalBinary>(&binary) &&
-         "Expected a MachO universal binary.");
-  auto *UB = cast<MachOUniversalBinary>(&binary);
-  for (auto OI = UB->begin_objects(), OE = UB->end_objects(); OI != OE; ++OI) {
-    auto objOrErr = OI->getAsObjectFile();
+  // The header information is cheap to read and is applied in slice order,
+  // so that later slices override earlier ones.
+  for (auto &slice : slices)
+    loadHeader(slice, file.get(), skipFlags);
 
-    // Ignore archives.
-    if (!objOrErr)
-      continue;
+  if (readFlags == ReadFlags::Header) {
+    file->finalize();
+    return file;
+  }
 
-    auto &object = *objOrErr.get();
-    switch (object.getHeader().filetype) {
-    default:
-      break;
-    case MachO::MH_DYLIB:
-    case MachO::MH_DYLIB_STUB:
-      load(&object, file.get());
-      break;
-    }
+  for (auto &slice : slices)
+    loadImageInfo(slice.object, file.get());
+
+  // Walking the export trie and the symbol table dominates the reading time,
+  // so the slices of large dylibs are read concurrently and merged afterwards.
+  // Starting threads costs more than reading the slices of small dylibs. The
+  // merge happens in slice order, which picks the same symbol flags as
+  // reading the slices one after the other.
+  uint64_t symbolCount = 0;
+  for (const auto &slice : slices)
+    symbolCount += slice.object->getSymtabLoadCommand().nsyms;
+  parallelFor(slices.size(),
+              symbolCount < parallelSymbolThreshold ? 1 : /*threadCount=*/0,
+              [&](size_t index) { loadSymbols(slices[index]); });
+
+  for (const auto &slice : slices) {
+    for (const auto &symbol : slice.exports)
+      file->addExportedSymbol(symbol.getName(), symbol.getType(),
+                              symbol.getFlags(), slice.arch);
+    for (const auto &symbol : slice.undefineds)
+      file->addUndefinedSymbol(symbol.getName(), symbol.getType(),
+                               symbol.getFlags(), slice.arch);
   }
 
-  return std::move(file);
+  file->finalize();
+  Instrumentation::add(Instrumentation::Counter::BinaryFilesRead, 1);
+  Instrumentation::add(Instrumentation::Counter::BytesRead,
+                       memBuffer.getBufferSize());
+  Instrumentation::add(Instrumentation::Counter::SymbolsRead,
+                       file->exports().size() + file->undefineds().size());
+  return file;
 }
 
 TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,93 @@
+//===- lib/Core/Parallel.cpp - Parallel Algorithms --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the parallel algorithms.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/Parallel.h"
+#include "tapi/Core/Instrumentation.h"
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// Set while the thread runs the work of a parallelFor.
+static thread_local bool isParallelWorker = false;
+
+namespace {
+/// Marks the thread as a worker for its lifetime.
+class WorkerScope {
+public:
+  WorkerScope() : _wasWorker(isParallelWorker) { isParallelWorker = true; }
+  ~WorkerScope() { isParallelWorker = _wasWorker; }
+
+private:
+  bool _wasWorker;
+};
+} // end anonymous namespace.
+
+unsigned getThreadCount(size_t count, unsigned threadCount) {
+  if (threadCount == 0)
+    threadCount = std::thread::hardware_concurrency();
+  if (count < threadCount)
+    threadCount = count;
+  return std::max(threadCount, 1U);
+}
+
+void parallelFor(size_t count, unsigned threadCount,
+                 function_ref<void(size_t)> fn) {
+  // A nested loop runs on the worker that reached it. The outer loop already
+  // keeps the threads busy, and nesting would start up to N * N threads.
+  threadCount = isParallelWorker ? 1 : getThreadCount(count, threadCount);
+  if (threadCount == 1) {
+    for (size_t i = 0; i != count; ++i)
+      fn(i);
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    WorkerScope scope;
+    for (auto i = next++; i < count; i = next++)
+      fn(i);
+  };
+
+  // The workers record into the trace of the calling thread, so that their
+  // timings and counters are attributed to the file being traced.
+  auto *trace = Instrumentation::getCurrentTrace();
+  auto tracedWorker = [&]() {
+    Instrumentation::TraceScope scope(trace);
+    worker();
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for (unsigned i = 1; i != threadCount; ++i) {
+    // Running out of threads is not fatal. The threads that did start and
+    // the calling thread pick up the remaining indices.
+    try {
+      threads.emplace_back(tracedWorker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  worker();
+
+  for (auto &thread : threads)
+    thread.join();
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,270 @@
+//===- lib/Core/ParsedInterfaceFile.cpp - Parsed Interface File -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the parsed interface file.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/ParsedInterfaceFile.h"
+#include "tapi/Core/Instrumentation.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+using LinkerSymbol = tapi::v1::Symbol;
+
+/// \brief Compare the concatenations lhsPrefix + lhsName and
+/// rhsPrefix + rhsName without creating them.
+static bool lessThan(StringRef lhsPrefix, StringRef lhsName,
+                     StringRef rhsPrefix, StringRef rhsName) {
+  StringRef lhs[] = {lhsPrefix, lhsName};
+  StringRef rhs[] = {rhsPrefix, rhsName};
+  unsigned l = 0, r = 0;
+  while (true) {
+    while (l < 2 && lhs[l].empty())
+      ++l;
+    while (r < 2 && rhs[r].empty())
+      ++r;
+    if (l == 2 || r == 2)
+      return l == 2 && r != 2;
+
+    auto length = std::min(lhs[l].size(), rhs[r].size());
+    auto result = lhs[l].take_front(length).compare(rhs[r].take_front(length));
+    if (result != 0)
+      return result < 0;
+    lhs[l] = lhs[l].drop_front(length);
+    rhs[r] = rhs[r].drop_front(length);
+  }
+}
+
+namespace {
+
+/// \brief The linker names of one kind of symbol in name order.
+///
+/// The symbols of an interface file are sorted by name and type, so the names
+/// of one symbol type remain sorted when they are all given the same prefix.
+class LinkerNameStream {
+public:
+  LinkerNameStream(const SymbolSet &symbols, SymbolType type, StringRef prefix,
+                   ArchitectureSet archs, bool skipLinkerDirectives)
+      : _it(symbols.begin()), _end(symbols.end()), _type(type),
+        _prefix(prefix), _archs(archs),
+        _skipLinkerDirectives(skipLinkerDirectives) {
+    if (_archs.empty())
+      _it = _end;
+    skip();
+  }
+
+  bool empty() const { return _it == _end; }
+  const Symbol &getSymbol() const { return *_it; }
+  StringRef getPrefix() const { return _prefix; }
+  ArchitectureSet getArchitectures() const { return _archs; }
+
+  void next() {
+    ++_it;
+    skip();
+  }
+
+  bool operator<(const LinkerNameStream &o) const {
+    return lessThan(_prefix, _it->getName(), o._prefix, o._it->getName());
+  }
+
+private:
+  bool matches(const Symbol &symbol) const {
+    if (symbol.getType() != _type)
+      return false;
+    if ((symbol.getArchitectures() & _archs).empty())
+      return false;
+    return !_skipLinkerDirectives || !symbol.getName().startswith("$ld$");
+  }
+
+  void skip() {
+    while (_it != _end && !matches(*_it))
+      ++_it;
+  }
+
+  SymbolSet::const_iterator _it;
+  SymbolSet::const_iterator _end;
+  SymbolType _type;
+  StringRef _prefix;
+  ArchitectureSet _archs;
+  bool _skipLinkerDirectives;
+};
+
+} // end anonymous namespace.
+
+static unsigned getArchIndex(Arch arch) {
+  return countTrailingZeros(static_cast<uint32_t>(arch));
+}
+
+using SymbolLists = std::vector<LinkerSymbol> *[sizeof(uint32_t) * 8];
+
+/// \brief Append the linker symbols of every architecture to its list in name
+/// order.
+///
+/// Every kind of linker symbol is already sorted by name, so the lists are
+/// produced by merging the kinds instead of sorting the linker symbols.
+static void projectSymbols(const SymbolSet &symbols, ArchitectureSet archs,
+                           ArchitectureSet objc1Archs,
+                           bool skipLinkerDirectives, SymbolLists &lists) {
+  ArchitectureSet objc2Archs;
+  for (auto arch : archs)
+    if (!objc1Archs.has(arch))
+      objc2Archs.set(arch);
+
+  // Count the symbols first to allocate the lists only once.
+  size_t sizes[sizeof(uint32_t) * 8] = {};
+  for (const auto &symbol : symbols) {
+    if (skipLinkerDirectives && symbol.isSymbol() &&
+        symbol.getName().startswith("$ld$"))
+      continue;
+    for (auto arch : symbol.getArchitectures() & archs) {
+      bool hasMetaClass = symbol.isObjCClass() && !objc1Archs.has(arch);
+      sizes[getArchIndex(arch)] += hasMetaClass ? 2 : 1;
+    }
+  }
+  for (auto arch : archs)
+    lists[getArchIndex(arch)]->reserve(sizes[getArchIndex(arch)]);
+
+  LinkerNameStream streams[] = {
+      {symbols, SymbolType::Symbol, "", archs, skipLinkerDirectives},
+      {symbols, SymbolType::ObjCClass, ".objc_class_name", objc1Archs, false},
+      {symbols, SymbolType::ObjCClass, "_OBJC_CLASS_$", objc2Archs, false},
+      {symbols, SymbolType::ObjCClass, "_OBJC_METACLASS_$", objc2Archs, false},
+      {symbols, SymbolType::ObjCInstanceVariable, "_OBJC_IVAR_$", archs,
+       false},
+  };
+
+  while (true) {
+    LinkerNameStream *next = nullptr;
+    for (auto &stream : streams)
+      if (!stream.empty() && (next == nullptr || stream < *next))
+        next = &stream;
+    if (next == nullptr)
+      break;
+
+    const auto &symbol = next->getSymbol();
+    std::string name;
+    name.reserve(next->getPrefix().size() + symbol.getName().size());
+    name.append(next->getPrefix().data(), next->getPrefix().size());
+    name.append(symbol.getName().data(), symbol.getName().size());
+    // The name is copied for every architecture but the last one, which
+    // takes it over.
+    auto symbolArchs = symbol.getArchitectures() & next->getArchitectures();
+    auto remaining = symbolArchs.count();
+    for (auto arch : symbolArchs) {
+      auto &list = *lists[getArchIndex(arch)];
+      if (--remaining == 0)
+        list.emplace_back(std::move(name), symbol.getFlags());
+      else
+        list.emplace_back(name, symbol.getFlags());
+    }
+    next->next();
+  }
+}
+
+static ArchitectureSet computeWeakDefinedArchs(const InterfaceFile &file) {
+  ArchitectureSet archs;
+  for (const auto &symbol : file.exports())
+    if (symbol.isWeakDefined())
+      archs |= symbol.getArchitectures();
+  return archs;
+}
+
+ParsedInterfaceFile::ParsedInterfaceFile(
+    std::unique_ptr<const InterfaceFile> file, ExportFilter filter)
+    : _file(std::move(file)), _directives(*_file),
+      _weakDefinedArchs(computeWeakDefinedArchs(*_file)),
+      _exportFilter(std::move(filter)) {
+  assert(_file->isFrozen() && "the interface file has to be frozen");
+  for (auto &slice : _publishedSlices)
+    slice.store(nullptr, std::memory_order_relaxed);
+}
+
+const ExportFilter &ParsedInterfaceFile::getExportFilter() const {
+  std::call_once(_exportFilterFlag, [this] {
+    if (_exportFilter.empty())
+      _exportFilter = ExportFilter::create(_file->exports());
+  });
+  return _exportFilter;
+}
+
+void ParsedInterfaceFile::expectSlices(ArchitectureSet archs) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (auto arch : archs)
+    if (_slices[getArchIndex(arch)] == nullptr)
+      _expectedArchs.set(arch);
+}
+
+const ParsedInterfaceFile::Slice &
+ParsedInterfaceFile::getSlice(Arch arch) const {
+  auto index = getArchIndex(arch);
+  if (const auto *slice =
+          _publishedSlices[index].load(std::memory_order_acquire))
+    return *slice;
+
+  ArchitectureSet archs(arch);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_slices[index] != nullptr)
+      return *_slices[index];
+
+    // Create all expected slices together with the requested one.
+    if (_expectedArchs.has(arch)) {
+      archs = _expectedArchs;
+      _expectedArchs = ArchitectureSet();
+    }
+  }
+
+  // Create the slices without holding the lock. If another thread creates the
+  // same slice in the meantime, its slice is used instead.
+  Instrumentation::Timer timer(Instrumentation::Phase::Projection);
+  std::unique_ptr<Slice> slices[maxArchs];
+  SymbolLists exports, undefineds;
+  ArchitectureSet objc1Archs;
+  for (auto sliceArch : archs) {
+    auto sliceIndex = getArchIndex(sliceArch);
+    slices[sliceIndex].reset(new Slice);
+    exports[sliceIndex] = &slices[sliceIndex]->exports;
+    undefineds[sliceIndex] = &slices[sliceIndex]->undefineds;
+    if (_file->getPlatform() == Platform::OSX && sliceArch == Arch::i386)
+      objc1Archs.set(sliceArch);
+  }
+
+  // The $ld$ directives are not exported.
+  projectSymbols(_file->exports(), archs, objc1Archs,
+                 /*skipLinkerDirectives=*/true, exports);
+  projectSymbols(_file->undefineds(), archs, objc1Archs,
+                 /*skipLinkerDirectives=*/false, undefineds);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (auto sliceArch : archs) {
+    auto sliceIndex = getArchIndex(sliceArch);
+    if (_slices[sliceIndex] != nullptr)
+      continue;
+    _slices[sliceIndex] = std::move(slices[sliceIndex]);
+    _publishedSlices[sliceIndex].store(_slices[sliceIndex].get(),
+                                       std::memory_order_release);
+  }
+  return *_slices[index];
+}
+
+std::unique_ptr<ParsedInterfaceFile::Slice>
+ParsedInterfaceFile::takeSlice(Arch arch) const {
+  auto index = getArchIndex(arch);
+  std::lock_guard<std::mutex> lock(_mutex);
+  assert(_slices[index] != nullptr && "the slice doesn't exist");
+  _publishedSlices[index].store(nullptr, std::memory_order_relaxed);
+  return std::move(_slices[index]);
+}
+
+TAPI_NAMESPACE_INTERNAL_END
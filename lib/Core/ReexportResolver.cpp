@@ -0,0 +1,197 @@
+//===- lib/Core/ReexportResolver.cpp - Re-export Resolver -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the resolver for re-exported libraries.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/ReexportResolver.h"
+#include "tapi/Core/ParsedInterfaceFile.h"
+#include <algorithm>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+const FlatExports::Export *FlatExports::find(StringRef name) const {
+  auto it = _index.find(name);
+  if (it == _index.end())
+    return nullptr;
+  return &_exports[it->second];
+}
+
+void FlatExports::add(StringRef name, SymbolFlags flags,
+                      const InterfaceFile &file, StringRef installName) {
+  if (_index.find(name) != _index.end())
+    return;
+
+  _index.insert(std::make_pair(name, _exports.size()));
+  _exports.push_back({name, flags, &file, installName});
+}
+
+void FlatExports::add(const FlatExports &other) {
+  // The names of the other exports live as long as the resolver.
+  for (const auto &entry : other._exports)
+    add(entry.name, entry.flags, *entry.file, entry.installName);
+}
+
+InterfaceFile *ReexportResolver::addFile(std::unique_ptr<InterfaceFile> file) {
+  auto result = _filesByInstallName.insert(
+      std::make_pair(file->getInstallName(), nullptr));
+  if (!result.second)
+    return result.first->second;
+
+  result.first->second = file.get();
+  _directives.insert(std::make_pair(file.get(), LinkerDirectives(*file)));
+  _files.emplace_back(std::move(file));
+  return result.first->second;
+}
+
+InterfaceFile *ReexportResolver::getFile(StringRef installName) {
+  auto it = _filesByInstallName.find(installName);
+  if (it != _filesByInstallName.end())
+    return it->second;
+
+  // Only try to load every missing library once.
+  if (_missingInstallNames.count(installName))
+    return nullptr;
+
+  auto file = _loader ? _loader(installName) : nullptr;
+  if (file == nullptr) {
+    auto *entry = &*_missingInstallNames.insert(installName).first;
+    _missingLibraries.emplace_back(entry->getKey());
+    return nullptr;
+  }
+
+  // The loader might return a file with a different install name, for
+  // example for a symlinked framework. Register it under both names.
+  auto *result = addFile(std::move(file));
+  _filesByInstallName.insert(std::make_pair(installName, result));
+  return result;
+}
+
+void ReexportResolver::resolve(InterfaceFile &file) {
+  auto result = _states.insert(std::make_pair(&file, State::Visiting));
+  if (!result.second)
+    return;
+
+  for (auto &ref : file.reexportedLibraries()) {
+    auto *library = getFile(ref.getInstallName());
+    ref.setInterfaceFile(library);
+    if (library == nullptr)
+      continue;
+
+    auto it = _states.find(library);
+    if (it != _states.end() && it->second == State::Visiting) {
+      _cycles.emplace_back(file.getInstallName(), library->getInstallName());
+      continue;
+    }
+    resolve(*library);
+  }
+
+  _states[&file] = State::Resolved;
+}
+
+void ReexportResolver::collect(
+    const InterfaceFile &file, Arch arch, const InterfaceFile &root,
+    FlatExports &result, DenseSet<const InterfaceFile *> &visited) const {
+  if (!visited.insert(&file).second)
+    return;
+
+  // Reuse the exports of a library that have already been flattened.
+  if (&file != &root) {
+    auto it = _flatExports.find(
+        std::make_pair(&file, static_cast<unsigned>(arch)));
+    if (it != _flatExports.end()) {
+      result.add(*it->second);
+      return;
+    }
+  }
+
+  // Apply the $ld$ directives the same way as LinkerInterfaceFile.
+  auto installName = file.getInstallName();
+  SmallVector<StringRef, 8> hiddenNames;
+  SmallVector<const LinkerDirectives::Directive *, 8> addedExports;
+  auto it = _directives.find(&file);
+  if (it != _directives.end()) {
+    for (const auto &directive : it->second.lookup(_minOSVersion)) {
+      if (!directive.archs.has(arch))
+        continue;
+
+      switch (directive.action) {
+      case LinkerDirectives::Action::Hide:
+        hiddenNames.emplace_back(directive.name);
+        break;
+      case LinkerDirectives::Action::Add:
+        addedExports.emplace_back(&directive);
+        break;
+      case LinkerDirectives::Action::InstallName:
+        installName = directive.name;
+        break;
+      case LinkerDirectives::Action::CompatibilityVersion:
+        break;
+      case LinkerDirectives::Action::Unknown:
+        // Unknown actions are exported as is.
+        if (std::find(hiddenNames.begin(), hiddenNames.end(), directive.name) ==
+            hiddenNames.end())
+          addedExports.emplace_back(&directive);
+        break;
+      }
+    }
+  }
+  std::sort(hiddenNames.begin(), hiddenNames.end());
+
+  // Only the names that sort after the $ld$ symbols are subject to the hide
+  // directives, because the linker processes them in sorted order.
+  auto isHidden = [&](StringRef name) {
+    return name > "$ld$" &&
+           std::binary_search(hiddenNames.begin(), hiddenNames.end(), name);
+  };
+
+  bool useObjC1ABI = file.getPlatform() == Platform::OSX && arch == Arch::i386;
+  std::string buffer;
+  for (const auto &symbol : file.exports()) {
+    if (!symbol.hasArch(arch))
+      continue;
+    if (symbol.isSymbol() && symbol.getName().startswith("$ld$"))
+      continue;
+    ParsedInterfaceFile::forEachLinkerName(
+        symbol, useObjC1ABI, buffer, [&](StringRef name) {
+          if (isHidden(name) || result.find(name) != nullptr)
+            return;
+          // Only the prefixed names need to be saved, the others are interned.
+          if (name.data() == buffer.data())
+            name = result._saver.save(name);
+          result.add(name, symbol.getFlags(), file, installName);
+        });
+  }
+
+  for (const auto *directive : addedExports)
+    result.add(directive->name, directive->flags, file, installName);
+
+  for (const auto &ref : file.reexportedLibraries())
+    if (ref.hasArchitecture(arch) && ref.getInterfaceFile() != nullptr)
+      collect(*ref.getInterfaceFile(), arch, root, result, visited);
+}
+
+const FlatExports &ReexportResolver::getExports(const InterfaceFile &file,
+                                                Arch arch) {
+  auto key = std::make_pair(&file, static_cast<unsigned>(arch));
+  auto it = _flatExports.find(key);
+  if (it != _flatExports.end())
+    return *it->second;
+
+  std::unique_ptr<FlatExports> result(new FlatExports);
+  DenseSet<const InterfaceFile *> visited;
+  collect(file, arch, file, *result, visited);
+  return *(_flatExports[key] = std::move(result));
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -13,15 +13,40 @@
 //===----------------------------------------------------------------------===//
 
 #include "tapi/Core/Registry.h"
+#include "tapi/Core/CompiledStub.h"
+#include "tapi/Core/InterfaceFile.h"
 #include "tapi/Core/MachODylibReader.h"
 #include "tapi/Core/TextStub_v1.h"
 #include "tapi/Core/TextStub_v2.h"
 #include "tapi/Core/YAMLReaderWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 
 TAPI_NAMESPACE_INTERNAL_BEGIN
 
+namespace {
+/// \brief A memory buffer that owns the string it refers to.
+class StringMemoryBuffer : public MemoryBuffer {
+public:
+  StringMemoryBuffer(std::string content, StringRef identifier)
+      : _content(std::move(content)), _identifier(identifier) {
+    init(_content.data(), _content.data() + _content.size(),
+         /*RequiresNullTerminator=*/true);
+  }
+
+  StringRef getBufferIdentifier() const override { return _identifier; }
+
+  BufferKind getBufferKind() const override { return MemoryBuffer_Malloc; }
+
+private:
+  std::string _content;
+  std::string _identifier;
+};
+} // end anonymous namespace.
+
 bool Registry::canRead(MemoryBufferRef memBuffer, FileType types) const {
   auto data = memBuffer.getBuffer();
   auto magic = llvm::identify_magic(data);
@@ -56,14 +81,16 @@ bool Registry::canWrite(const File *file) const {
   return false;
 }
 
-std::unique_ptr<File> Registry::readFile(MemoryBufferRef memBuffer) const {
+std::unique_ptr<File> Registry::readFile(MemoryBufferRef memBuffer,
+                                         ReadFlags readFlags,
+                                         SkipFlags skipFlags) const {
   auto data = memBuffer.getBuffer();
   auto fileType = llvm::identify_magic(data);
 
   for (const auto &reader : _readers) {
     if (!reader->canRead(fileType, memBuffer))
       continue;
-    return reader->readFile(memBuffer);
+    return reader->readFile(memBuffer, readFlags, skipFlags);
   }
 
   return nullptr;
@@ -79,6 +106,128 @@ std::error_code Registry::writeFile(const File *file) const {
   return std::make_error_code(std::errc::not_supported);
 }
 
+/// \brief Compare everything but the symbols and libraries of the files.
+static bool hasSameHeader(const InterfaceFile &lhs, const InterfaceFile &rhs) {
+  return lhs.getFileType() == rhs.getFileType() &&
+         lhs.uuids() == rhs.uuids() &&
+         lhs.getPlatform() == rhs.getPlatform() &&
+         lhs.getArchitectures() == rhs.getArchitectures() &&
+         lhs.getInstallName() == rhs.getInstallName() &&
+         lhs.getCurrentVersion() == rhs.getCurrentVersion() &&
+         lhs.getCompatibilityVersion() == rhs.getCompatibilityVersion() &&
+         lhs.getSwiftVersion() == rhs.getSwiftVersion() &&
+         lhs.getObjCConstraint() == rhs.getObjCConstraint() &&
+         lhs.isTwoLevelNamespace() == rhs.isTwoLevelNamespace() &&
+         lhs.isApplicationExtensionSafe() ==
+             rhs.isApplicationExtensionSafe() &&
+         lhs.getParentUmbrella() == rhs.getParentUmbrella();
+}
+
+static bool hasSameSymbols(const SymbolSet &lhs, const SymbolSet &rhs) {
+  if (lhs.size() != rhs.size())
+    return false;
+
+  // Names and types are unique within a set, so finding every symbol of one
+  // set in the other one is enough.
+  for (const auto &symbol : lhs) {
+    const auto *other = rhs.find(symbol.getName(), symbol.getType());
+    if (other == nullptr || other->getFlags() != symbol.getFlags() ||
+        other->getArchitectures() != symbol.getArchitectures())
+      return false;
+  }
+  return true;
+}
+
+static bool hasSameReferences(std::vector<InterfaceFileRef> lhs,
+                              std::vector<InterfaceFileRef> rhs) {
+  if (lhs.size() != rhs.size())
+    return false;
+
+  std::sort(lhs.begin(), lhs.end());
+  std::sort(rhs.begin(), rhs.end());
+  return lhs == rhs;
+}
+
+/// \brief Check if both files have the same symbols, re-exported libraries,
+/// and allowable clients.
+///
+/// This is what the content digest covers. Comparing the digests first
+/// rejects most changed files cheaply, but it can't tell files with colliding
+/// digests apart.
+static bool hasSameContent(const InterfaceFile &lhs, const InterfaceFile &rhs) {
+  return lhs.getContentDigest() == rhs.getContentDigest() &&
+         hasSameSymbols(lhs.exports(), rhs.exports()) &&
+         hasSameSymbols(lhs.undefineds(), rhs.undefineds()) &&
+         hasSameReferences(lhs.reexportedLibraries(),
+                           rhs.reexportedLibraries()) &&
+         hasSameReferences(lhs.allowableClients(), rhs.allowableClients());
+}
+
+/// \brief Check if the file at the path of the interface file has the same
+/// content.
+static bool isUpToDate(const Registry &registry, const InterfaceFile &file) {
+  auto bufferOrErr = MemoryBuffer::getFile(file.getPath());
+  if (!bufferOrErr)
+    return false;
+
+  auto bufferRef = bufferOrErr.get()->getMemBufferRef();
+  auto read = [&](ReadFlags readFlags) -> std::unique_ptr<InterfaceFile> {
+    auto existing = registry.readFile(bufferRef, readFlags);
+    if (!existing || existing->getErrorCode() ||
+        !isa<InterfaceFile>(existing.get()))
+      return nullptr;
+    return std::unique_ptr<InterfaceFile>(
+        cast<InterfaceFile>(existing.release()));
+  };
+
+  auto header = read(ReadFlags::Header);
+  if (!header || !hasSameHeader(*header, file))
+    return false;
+
+  auto existing = read(ReadFlags::All);
+  return existing && hasSameHeader(*existing, file) &&
+         hasSameContent(*existing, file);
+}
+
+std::error_code Registry::writeFileIfChanged(const File *file,
+                                             bool *written) const {
+  if (written != nullptr)
+    *written = false;
+
+  const auto *interface = dyn_cast<InterfaceFile>(file);
+  if (interface != nullptr && isUpToDate(*this, *interface))
+    return std::error_code();
+
+  if (auto ec = writeFile(file))
+    return ec;
+
+  if (written != nullptr)
+    *written = true;
+  return std::error_code();
+}
+
+std::error_code Registry::writeFile(raw_ostream &os, const File *file) const {
+  for (const auto &writer : _writers) {
+    if (!writer->canWrite(file))
+      continue;
+    return writer->writeFile(os, file);
+  }
+
+  return std::make_error_code(std::errc::not_supported);
+}
+
+ErrorOr<std::unique_ptr<MemoryBuffer>>
+Registry::writeFileToBuffer(const File *file) const {
+  std::string content;
+  raw_string_ostream os(content);
+  if (auto ec = writeFile(os, file))
+    return ec;
+  os.flush();
+
+  return std::unique_ptr<MemoryBuffer>(
+      new StringMemoryBuffer(std::move(content), file->getPath()));
+}
+
 void Registry::addBinaryReaders() {
   add(std::unique_ptr<Reader>(new MachODylibReader));
 }
@@ -101,4 +250,12 @@ void Registry::addYAMLWriters() {
   add(std::unique_ptr<Writer>(std::move(writer)));
 }
 
+void Registry::addCompiledStubReaders() {
+  add(std::unique_ptr<Reader>(new CompiledStubReader));
+}
+
+void Registry::addCompiledStubWriters() {
+  add(std::unique_ptr<Writer>(new CompiledStubWriter));
+}
+
 TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,219 @@
+//===- lib/Core/StringPool.cpp - Shared String Pool -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the thread-safe pool of interned strings.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/StringPool.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Allocator.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+namespace {
+
+/// \brief An interned string. The characters follow the entry in memory.
+struct Entry {
+  size_t hash;
+  size_t length;
+
+  const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+  StringRef getString() const { return StringRef(data(), length); }
+};
+
+/// \brief An open addressing hash table with linear probing.
+///
+/// Slots are only ever filled, never cleared. A table is replaced by a larger
+/// copy when it fills up, but the old table is kept alive, because readers
+/// might still be probing it.
+struct Table {
+  explicit Table(size_t capacity)
+      : mask(capacity - 1), slots(new std::atomic<const Entry *>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i)
+      slots[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  size_t getCapacity() const { return mask + 1; }
+
+  const Entry *find(StringRef string, size_t hash) const {
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      const auto *entry = slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr)
+        return nullptr;
+      if (entry->hash == hash && entry->getString() == string)
+        return entry;
+    }
+  }
+
+  void insert(const Entry *entry) {
+    auto i = entry->hash & mask;
+    while (slots[i].load(std::memory_order_relaxed) != nullptr)
+      i = (i + 1) & mask;
+    slots[i].store(entry, std::memory_order_release);
+  }
+
+  size_t mask;
+  std::unique_ptr<std::atomic<const Entry *>[]> slots;
+};
+
+} // end anonymous namespace.
+
+static const unsigned numShardBits = 5;
+static const unsigned numShards = 1U << numShardBits;
+static const size_t initialCapacity = 1024;
+
+/// \brief All empty strings share the same storage.
+static const char emptyString[] = "";
+
+class StringPool::Shard {
+public:
+  Shard() : _table(new Table(initialCapacity)) {
+    _tables.emplace_back(_table.load(std::memory_order_relaxed));
+  }
+
+  const Entry *find(StringRef string, size_t hash) const {
+    return _table.load(std::memory_order_acquire)->find(string, hash);
+  }
+
+  const Entry *insert(StringRef string, size_t hash) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto *table = _table.load(std::memory_order_relaxed);
+    if (const auto *entry = table->find(string, hash))
+      return entry;
+
+    // Keep the load factor below 3/4.
+    if ((_size + 1) * 4 > table->getCapacity() * 3) {
+      auto *grown = new Table(table->getCapacity() * 2);
+      _tables.emplace_back(grown);
+      for (size_t i = 0, e = table->getCapacity(); i != e; ++i) {
+        const auto *entry = table->slots[i].load(std::memory_order_relaxed);
+        if (entry != nullptr)
+          grown->insert(entry);
+      }
+      _table.store(grown, std::memory_order_release);
+      table = grown;
+    }
+
+    auto *memory = static_cast<char *>(_allocator.Allocate(
+        sizeof(Entry) + string.size(), alignof(Entry)));
+    auto *entry = new (memory) Entry{hash, string.size()};
+    std::copy(string.begin(), string.end(), memory + sizeof(Entry));
+    table->insert(entry);
+    ++_size;
+    _bytes += string.size();
+    return entry;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+  }
+
+  size_t getByteCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+  }
+
+private:
+  std::atomic<Table *> _table;
+  std::vector<std::unique_ptr<Table>> _tables;
+  mutable std::mutex _mutex;
+  BumpPtrAllocator _allocator;
+  size_t _size = 0;
+  size_t _bytes = 0;
+};
+
+StringPool::StringPool() : _shards(new Shard[numShards]), _releasedBytes(0) {}
+
+StringPool::~StringPool() = default;
+
+// Neither is ever destroyed, so files can still be created and destroyed
+// during the destruction of static objects.
+static std::mutex &getSessionMutex() {
+  static auto *mutex = new std::mutex;
+  return *mutex;
+}
+
+static std::weak_ptr<StringPool> &getCurrentSession() {
+  static auto *current = new std::weak_ptr<StringPool>;
+  return *current;
+}
+
+std::shared_ptr<StringPool> StringPool::getSession() {
+  std::lock_guard<std::mutex> lock(getSessionMutex());
+  auto &current = getCurrentSession();
+  auto pool = current.lock();
+  if (pool == nullptr || pool->isRetired()) {
+    pool = std::make_shared<StringPool>();
+    current = pool;
+  }
+  return pool;
+}
+
+void StringPool::startSession() {
+  std::lock_guard<std::mutex> lock(getSessionMutex());
+  getCurrentSession().reset();
+}
+
+static size_t getHash(StringRef string) { return hash_value(string); }
+
+static unsigned getShardIndex(size_t hash) {
+  // The low bits select the slot within the shard.
+  return hash >> (sizeof(size_t) * 8 - numShardBits);
+}
+
+StringRef StringPool::intern(StringRef string) {
+  if (string.empty())
+    return StringRef(emptyString, 0);
+
+  auto hash = getHash(string);
+  auto &shard = _shards[getShardIndex(hash)];
+  if (const auto *entry = shard.find(string, hash))
+    return entry->getString();
+  return shard.insert(string, hash)->getString();
+}
+
+StringRef StringPool::lookup(StringRef string) const {
+  if (string.empty())
+    return StringRef(emptyString, 0);
+
+  auto hash = getHash(string);
+  if (const auto *entry = _shards[getShardIndex(hash)].find(string, hash))
+    return entry->getString();
+  return StringRef();
+}
+
+size_t StringPool::size() const {
+  size_t size = 0;
+  for (unsigned i = 0; i < numShards; ++i)
+    size += _shards[i].size();
+  return size;
+}
+
+size_t StringPool::getByteCount() const {
+  size_t bytes = 0;
+  for (unsigned i = 0; i < numShards; ++i)
+    bytes += _shards[i].getByteCount();
+  return bytes;
+}
+
+bool StringPool::isRetired() const {
+  auto released = _releasedBytes.load(std::memory_order_relaxed);
+  return released != 0 && released * 2 >= getByteCount();
+}
+
+TAPI_NAMESPACE_INTERNAL_END
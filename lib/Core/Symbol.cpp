@@ -9,6 +9,7 @@
 
 #include "tapi/Core/Symbol.h"
 #include "tapi/Core/LLVM.h"
+#include "tapi/Core/STLExtras.h"
 //#include "llvm/Config/config.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -27,13 +28,13 @@ void AvailabilityInfo::print(raw_ostream &os) const {
 
 std::string Symbol::getPrettyName(bool demangle) const {
   if (!demangle)
-    return _name;
+    return _name.str();
 
 #if HAVE_CXXABI_H
-  if (demangle && StringRef(_name).startswith("__Z")) {
+  if (demangle && _name.startswith("__Z")) {
     int status = 0;
-    char *demangledName =
-        abi::__cxa_demangle(&_name[1], nullptr, nullptr, &status);
+    char *demangledName = abi::__cxa_demangle(_name.drop_front().str().c_str(),
+                                              nullptr, nullptr, &status);
     if (status == 0) {
       std::string result = demangledName;
       free(demangledName);
@@ -42,10 +43,10 @@ std::string Symbol::getPrettyName(bool demangle) const {
   }
 #endif
 
-  if (_name[0] == '_')
-    return _name.substr(1);
+  if (_name.startswith("_"))
+    return _name.drop_front().str();
 
-  return _name;
+  return _name.str();
 }
 
 std::string Symbol::getAnnotatedName(bool demangle) const {
@@ -65,10 +66,62 @@ std::string Symbol::getAnnotatedName(bool demangle) const {
   return name + getPrettyName(demangle);
 }
 
+static bool compareArch(const std::pair<Arch, AvailabilityInfo> &lhs,
+                        Arch rhs) {
+  return lhs.first < rhs;
+}
+
+const AvailabilityInfo *Symbol::findAvailability(Arch arch) const {
+  if (!_availability)
+    return nullptr;
+
+  auto it = lower_bound(*_availability, arch, compareArch);
+  if (it == _availability->end() || it->first != arch)
+    return nullptr;
+
+  return &it->second;
+}
+
+void Symbol::addAvailability(Arch arch, const AvailabilityInfo &info) {
+  if (hasAvailability(arch))
+    return;
+
+  if (!info._unavailable)
+    _archs.set(arch);
+
+  // Only record the availability information if it isn't the default.
+  if (info == AvailabilityInfo())
+    return;
+
+  if (!_availability)
+    _availability.reset(new AvailabilityMap);
+  auto it = lower_bound(*_availability, arch, compareArch);
+  _availability->emplace(it, arch, info);
+}
+
+bool Symbol::removeArch(Arch arch) {
+  if (!hasAvailability(arch))
+    return false;
+
+  _archs.clear(arch);
+  if (_availability) {
+    auto it = lower_bound(*_availability, arch, compareArch);
+    if (it != _availability->end() && it->first == arch)
+      _availability->erase(it);
+    if (_availability->empty())
+      _availability.reset();
+  }
+  return true;
+}
+
 void Symbol::print(raw_ostream &os) const {
   os << getAnnotatedName();
-  for (const auto &avail : _availability)
-    os << " " << getArchName(avail.first) << ":" << avail.second;
+  ArchitectureSet archs = _archs;
+  if (_availability)
+    for (const auto &avail : *_availability)
+      archs.set(avail.first);
+  for (auto arch : archs)
+    os << " " << getArchName(arch) << ":" << getAvailability(arch);
 }
 
 TAPI_NAMESPACE_INTERNAL_END
@@ -0,0 +1,131 @@
+//===- lib/Core/SymbolSet.cpp - TAPI Symbol Set -----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the symbol set.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/SymbolSet.h"
+#include <algorithm>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+static bool lessThan(const Symbol &symbol, StringRef name, SymbolType type) {
+  auto result = symbol.getName().compare(name);
+  if (result != 0)
+    return result < 0;
+  return symbol.getType() < type;
+}
+
+std::pair<Symbol *, bool> SymbolSet::insert(StringRef name, SymbolType type,
+                                            SymbolFlags flags) {
+  if (_isSorted) {
+    rebuildIndex();
+    _isSorted = false;
+  }
+
+  auto interned = _pool->intern(name);
+  auto result =
+      _index.insert(std::make_pair(getKey(interned, type), _symbols.size()));
+  if (!result.second)
+    return std::make_pair(&_symbols[result.first->second], false);
+
+  _nameBytes += interned.size();
+  _symbols.emplace_back(interned, type, flags);
+  return std::make_pair(&_symbols.back(), true);
+}
+
+bool SymbolSet::append(StringRef name, SymbolType type, SymbolFlags flags,
+                       ArchitectureSet archs) {
+  assert(_isSorted && "symbols can only be appended to a sorted set");
+  if (!_symbols.empty() && !lessThan(_symbols.back(), name, type))
+    return false;
+
+  auto interned = _pool->intern(name);
+  _nameBytes += interned.size();
+  _symbols.emplace_back(interned, type, flags);
+  _symbols.back().addArchitectures(archs);
+  return true;
+}
+
+const Symbol *SymbolSet::find(StringRef name, SymbolType type) const {
+  if (!_isSorted) {
+    // A name that has never been interned can't be in any set of the pool.
+    auto interned = _pool->lookup(name);
+    if (interned.data() == nullptr)
+      return nullptr;
+
+    auto it = _index.find(getKey(interned, type));
+    if (it == _index.end())
+      return nullptr;
+    return &_symbols[it->second];
+  }
+
+  auto index = lowerBound(name, type);
+  if (index == _symbols.size())
+    return nullptr;
+
+  const auto &symbol = _symbols[index];
+  if (symbol.getName() != name || symbol.getType() != type)
+    return nullptr;
+
+  return &symbol;
+}
+
+Symbol *SymbolSet::find(StringRef name, SymbolType type) {
+  return const_cast<Symbol *>(
+      static_cast<const SymbolSet *>(this)->find(name, type));
+}
+
+bool SymbolSet::erase(StringRef name, SymbolType type) {
+  const auto *symbol = find(name, type);
+  if (symbol == nullptr)
+    return false;
+
+  _symbols.erase(_symbols.begin() + (symbol - _symbols.data()));
+  if (!_isSorted)
+    rebuildIndex();
+  return true;
+}
+
+void SymbolSet::finalize() {
+  if (_isSorted)
+    return;
+
+  std::sort(_symbols.begin(), _symbols.end(),
+            [](const Symbol &lhs, const Symbol &rhs) {
+              return lessThan(lhs, rhs.getName(), rhs.getType());
+            });
+  _symbols.shrink_to_fit();
+  DenseMap<Key, unsigned>().swap(_index);
+  _isSorted = true;
+}
+
+void SymbolSet::rebuildIndex() {
+  _index.clear();
+  _index.reserve(_symbols.size());
+  for (unsigned i = 0, e = _symbols.size(); i != e; ++i) {
+    const auto &symbol = _symbols[i];
+    _index.insert(
+        std::make_pair(getKey(symbol.getName(), symbol.getType()), i));
+  }
+}
+
+size_t SymbolSet::lowerBound(StringRef name, SymbolType type) const {
+  auto it = std::lower_bound(_symbols.begin(), _symbols.end(), name,
+                             [type](const Symbol &symbol, StringRef name) {
+                               return lessThan(symbol, name, type);
+                             });
+  return it - _symbols.begin();
+}
+
+TAPI_NAMESPACE_INTERNAL_END
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "tapi/Core/TextStub_v1.h"
+#include "tapi/Core/Instrumentation.h"
 #include "tapi/Core/InterfaceFile.h"
 #include "tapi/Core/Registry.h"
 #include "tapi/Core/YAML.h"
@@ -64,17 +65,11 @@ template <> struct MappingTraits<const InterfaceFile *> {
         archSet.insert(library.getArchitectures());
 
       std::map<const TAPI_INTERNAL::Symbol *, ArchitectureSet> symbolToArchSet;
-      for (const auto &it : file->exports()) {
-        auto &symbol = it.second;
+      for (const auto &symbol : file->exports()) {
         if (symbol.isUnavailable())
           continue;
 
-        ArchitectureSet archs;
-        for (auto availMap : symbol._availability) {
-          if (availMap.second._unavailable)
-            continue;
-          archs.set(availMap.first);
-        }
+        auto archs = symbol.getArchitectures();
         symbolToArchSet[&symbol] = archs;
         archSet.insert(archs);
       }
@@ -126,6 +121,8 @@ template <> struct MappingTraits<const InterfaceFile *> {
       auto ctx = reinterpret_cast<YAMLContext *>(io.getContext());
       assert(ctx);
 
+      Instrumentation::Timer timer(Instrumentation::Phase::Denormalize);
+
       auto *file = new InterfaceFile;
       file->setPath(ctx->_path);
       file->setFileType(TAPI_INTERNAL::FileType::TBD_V1);
@@ -139,28 +136,32 @@ template <> struct MappingTraits<const InterfaceFile *> {
       file->setApplicationExtensionSafe();
       file->setObjCConstraint(objcConstraint);
 
+      bool skipClients = (ctx->_skipFlags & SkipFlags::AllowableClients) !=
+                         SkipFlags::None;
       for (const auto &section : exports) {
-        for (const auto &client : section.allowableClients)
-          file->addAllowableClient(client, section.archs);
+        if (!skipClients)
+          for (const auto &client : section.allowableClients)
+            file->addAllowableClient(client, section.archs);
         for (const auto &lib : section.reexportedLibraries)
           file->addReexportedLibrary(lib, section.archs);
         for (auto &sym : section.symbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
-                                  SymbolFlags::None, section.archs);
+          file->addExportedSymbol(sym, SymbolType::Symbol, SymbolFlags::None,
+                                  section.archs);
         for (auto &sym : section.classes)
-          file->addExportedSymbol(sym.str(), SymbolType::ObjCClass,
-                                  SymbolFlags::None, section.archs);
+          file->addExportedSymbol(sym, SymbolType::ObjCClass, SymbolFlags::None,
+                                  section.archs);
         for (auto &sym : section.ivars)
-          file->addExportedSymbol(sym.str(), SymbolType::ObjCInstanceVariable,
+          file->addExportedSymbol(sym, SymbolType::ObjCInstanceVariable,
                                   SymbolFlags::None, section.archs);
         for (auto &sym : section.weakDefSymbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
+          file->addExportedSymbol(sym, SymbolType::Symbol,
                                   SymbolFlags::WeakDefined, section.archs);
         for (auto &sym : section.tlvSymbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
+          file->addExportedSymbol(sym, SymbolType::Symbol,
                                   SymbolFlags::ThreadLocalValue, section.archs);
       }
 
+      file->finalize();
       return file;
     }
 
@@ -206,15 +207,8 @@ bool TextBasedStubDocumentHandler::canRead(llvm::MemoryBufferRef memBufferRef,
   if (!(types & FileType::TBD_V1))
     return false;
 
-  if (!memBufferRef.getBufferIdentifier().endswith(".tbd"))
-    return false;
-
-  auto str = memBufferRef.getBuffer().trim();
-  if (!(str.startswith("---\n") || str.startswith("--- !tapi-tbd-v1\n")) ||
-      !str.endswith("..."))
-    return false;
-
-  return true;
+  auto tag = getDocumentTag(memBufferRef);
+  return tag && (tag->empty() || *tag == "!tapi-tbd-v1");
 }
 
 FileType TextBasedStubDocumentHandler::getFileType(
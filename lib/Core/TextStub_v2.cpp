@@ -13,11 +13,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "tapi/Core/TextStub_v2.h"
+#include "tapi/Core/Instrumentation.h"
 #include "tapi/Core/InterfaceFile.h"
 #include "tapi/Core/Registry.h"
 #include "tapi/Core/YAML.h"
 #include "tapi/Core/YAMLReaderWriter.h"
-#include <set>
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSwitch.h"
+#include <map>
 
 using namespace llvm;
 using namespace llvm::yaml;
@@ -25,12 +30,100 @@ using namespace TAPI_INTERNAL;
 using namespace TAPI_INTERNAL::stub::v2;
 using TAPI_INTERNAL::SymbolFlags;
 
-using UUID = std::pair<Arch, std::string>;
+using ArchUUID = std::pair<Arch, UUID>;
 //LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(StringRef)
-LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(UUID)
+LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(ArchUUID)
 LLVM_YAML_IS_SEQUENCE_VECTOR(ExportSection)
 LLVM_YAML_IS_SEQUENCE_VECTOR(UndefinedSection)
 
+/// \brief Group the exported content of the file by architecture set.
+///
+/// The sections are ordered by architecture set and the symbol lists in each
+/// section are sorted.
+static std::vector<ExportSection> getExportSections(const InterfaceFile &file) {
+  std::map<ArchitectureSet, ExportSection> sections;
+  for (const auto &library : file.allowableClients())
+    sections[library.getArchitectures()].allowableClients.emplace_back(
+        library.getInstallName());
+
+  for (const auto &library : file.reexportedLibraries())
+    sections[library.getArchitectures()].reexportedLibraries.emplace_back(
+        library.getInstallName());
+
+  for (const auto &symbol : file.exports()) {
+    if (symbol.isUnavailable())
+      continue;
+
+    auto &section = sections[symbol.getArchitectures()];
+    switch (symbol.getType()) {
+    case SymbolType::Symbol:
+      if (symbol.isWeakDefined())
+        section.weakDefSymbols.emplace_back(symbol.getName());
+      else if (symbol.isThreadLocalValue())
+        section.tlvSymbols.emplace_back(symbol.getName());
+      else
+        section.symbols.emplace_back(symbol.getName());
+      break;
+    case SymbolType::ObjCClass:
+      section.classes.emplace_back(symbol.getName());
+      break;
+    case SymbolType::ObjCInstanceVariable:
+      section.ivars.emplace_back(symbol.getName());
+      break;
+    }
+  }
+
+  std::vector<ExportSection> result;
+  result.reserve(sections.size());
+  for (auto &entry : sections) {
+    auto &section = entry.second;
+    section.archs = entry.first;
+    sort(section.symbols);
+    sort(section.classes);
+    sort(section.ivars);
+    sort(section.weakDefSymbols);
+    sort(section.tlvSymbols);
+    result.emplace_back(std::move(section));
+  }
+  return result;
+}
+
+/// \brief Group the undefined symbols of the file by architecture set.
+static std::vector<UndefinedSection>
+getUndefinedSections(const InterfaceFile &file) {
+  std::map<ArchitectureSet, UndefinedSection> sections;
+  for (const auto &symbol : file.undefineds()) {
+    auto &section = sections[symbol.getArchitectures()];
+    switch (symbol.getType()) {
+    case SymbolType::Symbol:
+      if (symbol.isWeakReferenced())
+        section.weakRefSymbols.emplace_back(symbol.getName());
+      else
+        section.symbols.emplace_back(symbol.getName());
+      break;
+    case SymbolType::ObjCClass:
+      section.classes.emplace_back(symbol.getName());
+      break;
+    case SymbolType::ObjCInstanceVariable:
+      section.ivars.emplace_back(symbol.getName());
+      break;
+    }
+  }
+
+  std::vector<UndefinedSection> result;
+  result.reserve(sections.size());
+  for (auto &entry : sections) {
+    auto &section = entry.second;
+    section.archs = entry.first;
+    sort(section.symbols);
+    sort(section.classes);
+    sort(section.ivars);
+    sort(section.weakRefSymbols);
+    result.emplace_back(std::move(section));
+  }
+  return result;
+}
+
 namespace llvm {
 namespace yaml {
 
@@ -65,12 +158,12 @@ template <> struct ScalarBitSetTraits<Flags> {
   }
 };
 
-template <> struct ScalarTraits<UUID> {
-  static void output(const UUID &value, void *, raw_ostream &os) {
+template <> struct ScalarTraits<ArchUUID> {
+  static void output(const ArchUUID &value, void *, raw_ostream &os) {
     os << getArchName(value.first) << ": " << value.second;
   }
 
-  static StringRef input(StringRef scalar, void *, UUID &value) {
+  static StringRef input(StringRef scalar, void *, ArchUUID &value) {
     auto split = scalar.split(':');
     auto arch = split.first.trim();
     auto uuid = split.second.trim();
@@ -79,7 +172,8 @@ template <> struct ScalarTraits<UUID> {
     value.first = getArchType(arch);
     if (value.first == Arch::unknown)
       return "unknown architecture";
-    value.second = uuid;
+    if (!value.second.parse(uuid))
+      return "invalid uuid";
     return StringRef();
   }
 
@@ -108,128 +202,25 @@ template <> struct MappingTraits<const InterfaceFile *> {
 
       parentUmbrella = file->getParentUmbrella();
 
-      std::set<ArchitectureSet> archSet;
-      for (const auto &library : file->allowableClients())
-        archSet.insert(library.getArchitectures());
-
-      for (const auto &library : file->reexportedLibraries())
-        archSet.insert(library.getArchitectures());
-
-      std::map<const TAPI_INTERNAL::Symbol *, ArchitectureSet> symbolToArchSet;
-      for (const auto &it : file->exports()) {
-        auto &symbol = it.second;
-        if (symbol.isUnavailable())
-          continue;
-
-        ArchitectureSet archs;
-        for (auto availMap : symbol._availability) {
-          if (availMap.second._unavailable)
-            continue;
-          archs.set(availMap.first);
-        }
-        symbolToArchSet[&symbol] = archs;
-        archSet.insert(archs);
-      }
-
-      for (auto archs : archSet) {
-        ExportSection section;
-        section.archs = archs;
-
-        for (const auto &library : file->allowableClients())
-          if (library.getArchitectures() == archs)
-            section.allowableClients.emplace_back(library.getInstallName());
-
-        for (const auto &library : file->reexportedLibraries())
-          if (library.getArchitectures() == archs)
-            section.reexportedLibraries.emplace_back(library.getInstallName());
-
-        for (const auto &symArch : symbolToArchSet) {
-          if (symArch.second != archs)
-            continue;
-
-          const auto *symbol = symArch.first;
-          switch (symbol->getType()) {
-          case SymbolType::Symbol:
-            if (symbol->isWeakDefined())
-              section.weakDefSymbols.emplace_back(symbol->getName());
-            else if (symbol->isThreadLocalValue())
-              section.tlvSymbols.emplace_back(symbol->getName());
-            else
-              section.symbols.emplace_back(symbol->getName());
-            break;
-          case SymbolType::ObjCClass:
-            section.classes.emplace_back(symbol->getName());
-            break;
-          case SymbolType::ObjCInstanceVariable:
-            section.ivars.emplace_back(symbol->getName());
-            break;
-          }
-        }
-        sort(section.symbols);
-        sort(section.classes);
-        sort(section.ivars);
-        sort(section.weakDefSymbols);
-        sort(section.tlvSymbols);
-        exports.emplace_back(std::move(section));
-      }
-
-      archSet.clear();
-      symbolToArchSet.clear();
-
-      for (const auto &it : file->undefineds()) {
-        auto &symbol = it.second;
-
-        ArchitectureSet archs;
-        for (auto availMap : symbol._availability) {
-          if (availMap.second._unavailable)
-            continue;
-          archs.set(availMap.first);
-        }
-        symbolToArchSet[&symbol] = archs;
-        archSet.insert(archs);
-      }
-
-      for (auto archs : archSet) {
-        UndefinedSection section;
-        section.archs = archs;
-
-        for (const auto &symArch : symbolToArchSet) {
-          if (symArch.second != archs)
-            continue;
-
-          const auto *symbol = symArch.first;
-          switch (symbol->getType()) {
-          case SymbolType::Symbol:
-            if (symbol->isWeakReferenced())
-              section.weakRefSymbols.emplace_back(symbol->getName());
-            else
-              section.symbols.emplace_back(symbol->getName());
-            break;
-          case SymbolType::ObjCClass:
-            section.classes.emplace_back(symbol->getName());
-            break;
-          case SymbolType::ObjCInstanceVariable:
-            section.ivars.emplace_back(symbol->getName());
-            break;
-          }
-        }
-        sort(section.symbols);
-        sort(section.classes);
-        sort(section.ivars);
-        sort(section.weakRefSymbols);
-        undefineds.emplace_back(std::move(section));
-      }
+      exports = getExportSections(*file);
+      undefineds = getUndefinedSections(*file);
     }
 
     const InterfaceFile *denormalize(IO &io) {
       auto ctx = reinterpret_cast<YAMLContext *>(io.getContext());
       assert(ctx);
 
+      Instrumentation::Timer timer(Instrumentation::Phase::Denormalize);
+
       auto *file = new InterfaceFile;
       file->setPath(ctx->_path);
       file->setFileType(TAPI_INTERNAL::FileType::TBD_V2);
-      for (auto &id : uuids)
-        file->addUUID(id.first, id.second);
+      auto skip = [ctx](SkipFlags section) {
+        return (ctx->_skipFlags & section) != SkipFlags::None;
+      };
+      if (!skip(SkipFlags::UUIDs))
+        for (auto &id : uuids)
+          file->addUUID(id.first, id.second);
       file->setPlatform(platform);
       file->setArchitectures(archs);
       file->setInstallName(installName);
@@ -244,47 +235,53 @@ template <> struct MappingTraits<const InterfaceFile *> {
           !(flags & Flags::NotApplicationExtensionSafe));
 
       for (const auto &section : exports) {
-        for (const auto &client : section.allowableClients)
-          file->addAllowableClient(client, section.archs);
+        if (!skip(SkipFlags::AllowableClients))
+          for (const auto &client : section.allowableClients)
+            file->addAllowableClient(client, section.archs);
         for (const auto &lib : section.reexportedLibraries)
           file->addReexportedLibrary(lib, section.archs);
         for (auto &sym : section.symbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
-                                  SymbolFlags::None, section.archs);
+          file->addExportedSymbol(sym, SymbolType::Symbol, SymbolFlags::None,
+                                  section.archs);
         for (auto &sym : section.classes)
-          file->addExportedSymbol(sym.str(), SymbolType::ObjCClass,
-                                  SymbolFlags::None, section.archs);
+          file->addExportedSymbol(sym, SymbolType::ObjCClass, SymbolFlags::None,
+                                  section.archs);
         for (auto &sym : section.ivars)
-          file->addExportedSymbol(sym.str(), SymbolType::ObjCInstanceVariable,
+          file->addExportedSymbol(sym, SymbolType::ObjCInstanceVariable,
                                   SymbolFlags::None, section.archs);
         for (auto &sym : section.weakDefSymbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
+          file->addExportedSymbol(sym, SymbolType::Symbol,
                                   SymbolFlags::WeakDefined, section.archs);
         for (auto &sym : section.tlvSymbols)
-          file->addExportedSymbol(sym.str(), SymbolType::Symbol,
+          file->addExportedSymbol(sym, SymbolType::Symbol,
                                   SymbolFlags::ThreadLocalValue, section.archs);
       }
 
+      // The YAML parser can't skip the undefineds, but at least don't keep
+      // them.
+      if (skip(SkipFlags::Undefineds))
+        undefineds.clear();
       for (const auto &section : undefineds) {
         for (auto &sym : section.symbols)
-          file->addUndefinedSymbol(sym.str(), SymbolType::Symbol,
-                                   SymbolFlags::None, section.archs);
+          file->addUndefinedSymbol(sym, SymbolType::Symbol, SymbolFlags::None,
+                                   section.archs);
         for (auto &sym : section.classes)
-          file->addUndefinedSymbol(sym.str(), SymbolType::ObjCClass,
+          file->addUndefinedSymbol(sym, SymbolType::ObjCClass,
                                    SymbolFlags::None, section.archs);
         for (auto &sym : section.ivars)
-          file->addUndefinedSymbol(sym.str(), SymbolType::ObjCInstanceVariable,
+          file->addUndefinedSymbol(sym, SymbolType::ObjCInstanceVariable,
                                    SymbolFlags::None, section.archs);
         for (auto &sym : section.weakRefSymbols)
-          file->addUndefinedSymbol(sym.str(), SymbolType::Symbol,
+          file->addUndefinedSymbol(sym, SymbolType::Symbol,
                                    SymbolFlags::WeakReferenced, section.archs);
       }
 
+      file->finalize();
       return file;
     }
 
     ArchitectureSet archs;
-    std::vector<UUID> uuids;
+    std::vector<ArchUUID> uuids;
     Platform platform;
     StringRef installName;
     PackedVersion currentVersion;
@@ -301,7 +298,14 @@ template <> struct MappingTraits<const InterfaceFile *> {
     MappingNormalization<NormalizedTBD2, const InterfaceFile *> keys(io, file);
     io.mapTag("!tapi-tbd-v2", true);
     io.mapRequired("archs", keys->archs);
-    io.mapOptional("uuids", keys->uuids);
+    // Skipped UUIDs are read as plain strings, so that they aren't parsed.
+    auto ctx = reinterpret_cast<YAMLContext *>(io.getContext());
+    if (!io.outputting() && ctx != nullptr &&
+        (ctx->_skipFlags & SkipFlags::UUIDs) != SkipFlags::None) {
+      std::vector<StringRef> uuids;
+      io.mapOptional("uuids", uuids);
+    } else
+      io.mapOptional("uuids", keys->uuids);
     io.mapRequired("platform", keys->platform);
     io.mapOptional("flags", keys->flags, Flags::None);
     io.mapRequired("install-name", keys->installName);
@@ -326,21 +330,876 @@ TAPI_NAMESPACE_INTERNAL_BEGIN
 namespace stub {
 namespace v2 {
 
-bool TextBasedStubDocumentHandler::canRead(llvm::MemoryBufferRef memBufferRef,
-                                           FileType types) const {
-  if (!(types & FileType::TBD_V2))
+namespace {
+
+/// \brief Single-pass reader for text-based stub v2 documents.
+///
+/// The reader only understands the restricted YAML subset that the TBD
+/// writers emit and adds the parsed content directly to the interface file,
+/// without building a YAML node tree or an intermediate normalized
+/// representation. Keys have to appear in the same order as they are written.
+/// Anything else (comments after values, multi-line or escaped scalars, tags,
+/// anchors, ...) makes the reader give up, so that the caller can fall back to
+/// the generic YAML parser, which also produces the diagnostics for malformed
+/// files.
+class DirectReader {
+public:
+  DirectReader(StringRef buffer, ReadFlags readFlags, SkipFlags skipFlags)
+      : _buffer(buffer), _readFlags(readFlags), _skipFlags(skipFlags) {}
+
+  bool read(InterfaceFile &file);
+
+private:
+  using ScalarCallback = function_ref<bool(StringRef)>;
+
+  void nextLine();
+  bool parseScalar(StringRef &cur, bool inFlow, StringRef &value);
+  bool parseScalarValue(StringRef cur, StringRef &value);
+  bool parseFlowSequence(StringRef cur, unsigned indent,
+                         ScalarCallback callback);
+  bool parseBlockSequence(unsigned indent, ScalarCallback callback);
+  bool parseSequence(StringRef cur, unsigned indent, ScalarCallback callback);
+  bool parseArchitectures(StringRef cur, unsigned indent,
+                          ArchitectureSet &archs);
+  bool parseSections(InterfaceFile &file, bool exports);
+  bool parseSection(InterfaceFile &file, bool exports);
+  bool skip(SkipFlags section) const {
+    return (_skipFlags & section) != SkipFlags::None;
+  }
+  bool isRemainderOfDocument() const;
+
+  /// The unconsumed part of the buffer.
+  StringRef _buffer;
+  ReadFlags _readFlags;
+  SkipFlags _skipFlags;
+
+  /// The current line without indentation and trailing spaces.
+  StringRef _line;
+  unsigned _indent = 0;
+  bool _eof = false;
+
+  /// Storage for scalars that contain quote escapes.
+  SmallString<128> _scratch;
+};
+
+enum TopLevelKey {
+  TK_Archs,
+  TK_UUIDs,
+  TK_Platform,
+  TK_Flags,
+  TK_InstallName,
+  TK_CurrentVersion,
+  TK_CompatibilityVersion,
+  TK_SwiftVersion,
+  TK_ObjCConstraint,
+  TK_ParentUmbrella,
+  TK_Exports,
+  TK_Undefineds,
+  TK_Unknown = -1,
+};
+
+enum SectionKey {
+  SK_Archs,
+  SK_AllowableClients,
+  SK_ReexportedLibraries,
+  SK_Symbols,
+  SK_ObjCClasses,
+  SK_ObjCInstanceVariables,
+  SK_WeakDefSymbols,
+  SK_ThreadLocalSymbols,
+  SK_WeakRefSymbols,
+  SK_Unknown = -1,
+};
+
+/// \brief Single-pass writer for text-based stub v2 documents.
+///
+/// The writer produces the same output as the YAML writer, but streams the
+/// document straight to the output stream instead of building the normalized
+/// representation and going through the generic YAML output first. It mirrors
+/// the layout of llvm::yaml::Output: keys are padded to a column of 17,
+/// sequences of strings are written as block sequences, and flow sequences
+/// wrap once they extend past column 80.
+class DirectWriter {
+public:
+  DirectWriter(raw_ostream &os) : _os(os) {}
+
+  void write(const InterfaceFile &file);
+
+private:
+  void output(StringRef str) {
+    _os << str;
+    _column += str.size();
+  }
+  void newLine(unsigned indent);
+  void key(StringRef name);
+  void key(unsigned indent, StringRef name) {
+    newLine(indent);
+    key(name);
+  }
+  void string(StringRef value, bool mustQuote);
+  template <typename T> void scalar(const T &value);
+  void architectures(ArchitectureSet archs);
+  void flags(Flags flags);
+  void uuids(const std::vector<ArchUUID> &uuids);
+  void sequence(StringRef key, const std::vector<StringRef> &values);
+
+  raw_ostream &_os;
+  unsigned _column = 0;
+};
+
+} // end anonymous namespace.
+
+static bool splitKey(StringRef line, StringRef &key, StringRef &value) {
+  auto pos = line.find(':');
+  if (pos == StringRef::npos)
     return false;
 
-  if (!memBufferRef.getBufferIdentifier().endswith(".tbd"))
+  key = line.substr(0, pos);
+  value = line.substr(pos + 1);
+  if (!value.empty() && value.front() != ' ')
     return false;
+  value = value.ltrim(' ');
+
+  return !key.empty() &&
+         key.find_first_not_of("abcdefghijklmnopqrstuvwxyz-") ==
+             StringRef::npos;
+}
 
-  auto str = memBufferRef.getBuffer().trim();
-  if (!str.startswith("--- !tapi-tbd-v2\n") || !str.endswith("..."))
+static bool parsePlatform(StringRef scalar, Platform &platform) {
+  auto result = StringSwitch<Optional<Platform>>(scalar)
+                    .Case("unknown", Platform::Unknown)
+                    .Case("macosx", Platform::OSX)
+                    .Case("ios", Platform::iOS)
+                    .Case("watchos", Platform::watchOS)
+                    .Case("tvos", Platform::tvOS)
+                    .Default(llvm::None);
+  if (!result)
     return false;
+  platform = *result;
+  return true;
+}
 
+static bool parseObjCConstraint(StringRef scalar, ObjCConstraint &constraint) {
+  auto result =
+      StringSwitch<Optional<ObjCConstraint>>(scalar)
+          .Case("none", ObjCConstraint::None)
+          .Case("retain_release", ObjCConstraint::Retain_Release)
+          .Case("retain_release_for_simulator",
+                ObjCConstraint::Retain_Release_For_Simulator)
+          .Case("retain_release_or_gc", ObjCConstraint::Retain_Release_Or_GC)
+          .Case("gc", ObjCConstraint::GC)
+          .Default(llvm::None);
+  if (!result)
+    return false;
+  constraint = *result;
   return true;
 }
 
+void DirectReader::nextLine() {
+  while (!_buffer.empty()) {
+    auto split = _buffer.split('\n');
+    _buffer = split.second;
+
+    auto content = split.first.ltrim(' ');
+    // Skip empty lines and comments.
+    if (content.empty() || content.front() == '#')
+      continue;
+
+    _indent = split.first.size() - content.size();
+    _line = content.rtrim(' ');
+    return;
+  }
+
+  _line = StringRef();
+  _indent = 0;
+  _eof = true;
+}
+
+bool DirectReader::parseScalar(StringRef &cur, bool inFlow, StringRef &value) {
+  if (cur.empty())
+    return false;
+
+  if (cur.front() == '\'') {
+    _scratch.clear();
+    bool escaped = false;
+    size_t start = 1;
+    while (true) {
+      auto end = cur.find('\'', start);
+      // Multi-line quoted scalars are not supported.
+      if (end == StringRef::npos)
+        return false;
+
+      // Two single quotes represent one single quote.
+      if (end + 1 < cur.size() && cur[end + 1] == '\'') {
+        _scratch.append(cur.slice(start, end + 1));
+        start = end + 2;
+        escaped = true;
+        continue;
+      }
+
+      if (escaped) {
+        _scratch.append(cur.slice(start, end));
+        value = _scratch.str();
+      } else
+        value = cur.slice(1, end);
+      cur = cur.drop_front(end + 1).ltrim(' ');
+      return true;
+    }
+  }
+
+  if (cur.front() == '"') {
+    auto end = cur.find('"', 1);
+    if (end == StringRef::npos)
+      return false;
+    value = cur.slice(1, end);
+    // Escape sequences are not supported.
+    if (value.find('\\') != StringRef::npos)
+      return false;
+    cur = cur.drop_front(end + 1).ltrim(' ');
+    return true;
+  }
+
+  // Plain scalars must not start with an indicator character.
+  if (StringRef("-?:,[]{}#&*!|>'\"%@`").find(cur.front()) != StringRef::npos)
+    return false;
+
+  auto end = cur.size();
+  if (inFlow) {
+    end = cur.find_first_of(",[]{}");
+    // Plain scalars in flow sequences have to end on the same line.
+    if (end == StringRef::npos || (cur[end] != ',' && cur[end] != ']'))
+      return false;
+  }
+
+  value = cur.substr(0, end).rtrim(' ');
+  cur = cur.drop_front(end);
+
+  // Reject anything that could be a mapping, a comment, or a null value.
+  if (value.find(" #") != StringRef::npos ||
+      value.find(": ") != StringRef::npos || value.endswith(":") ||
+      (inFlow && value.find(':') != StringRef::npos))
+    return false;
+  if (value == "~" || value == "null" || value == "Null" || value == "NULL")
+    return false;
+
+  return true;
+}
+
+bool DirectReader::parseScalarValue(StringRef cur, StringRef &value) {
+  if (!parseScalar(cur, /*inFlow=*/false, value) || !cur.empty())
+    return false;
+  nextLine();
+  return true;
+}
+
+bool DirectReader::parseFlowSequence(StringRef cur, unsigned indent,
+                                     ScalarCallback callback) {
+  assert(cur.front() == '[' && "expected flow sequence");
+  cur = cur.drop_front().ltrim(' ');
+
+  // Flow sequences may continue on the following lines, as long as those are
+  // indented further than the key.
+  auto fill = [&]() {
+    while (cur.empty()) {
+      nextLine();
+      if (_eof || _indent <= indent)
+        return false;
+      cur = _line;
+    }
+    return true;
+  };
+
+  if (!fill())
+    return false;
+  if (cur.front() != ']') {
+    while (true) {
+      StringRef value;
+      if (!parseScalar(cur, /*inFlow=*/true, value) || !callback(value))
+        return false;
+      if (!fill())
+        return false;
+      if (cur.front() == ']')
+        break;
+      if (cur.front() != ',')
+        return false;
+      cur = cur.drop_front().ltrim(' ');
+      if (!fill())
+        return false;
+    }
+  }
+
+  // Nothing may follow the closing bracket.
+  if (!cur.drop_front().ltrim(' ').empty())
+    return false;
+
+  nextLine();
+  return true;
+}
+
+bool DirectReader::parseBlockSequence(unsigned indent,
+                                      ScalarCallback callback) {
+  if (_eof || _indent <= indent)
+    return false;
+
+  auto itemIndent = _indent;
+  while (!_eof && _indent == itemIndent && _line.startswith("- ")) {
+    auto cur = _line.drop_front(2).ltrim(' ');
+    StringRef value;
+    if (!parseScalar(cur, /*inFlow=*/false, value) || !cur.empty() ||
+        !callback(value))
+      return false;
+    nextLine();
+  }
+
+  // The next line has to belong to an enclosing mapping.
+  return _eof || _indent <= indent;
+}
+
+bool DirectReader::parseSequence(StringRef cur, unsigned indent,
+                                 ScalarCallback callback) {
+  if (cur.empty()) {
+    nextLine();
+    return parseBlockSequence(indent, callback);
+  }
+
+  if (cur.front() == '[')
+    return parseFlowSequence(cur, indent, callback);
+
+  return false;
+}
+
+bool DirectReader::parseArchitectures(StringRef cur, unsigned indent,
+                                      ArchitectureSet &archs) {
+  return parseSequence(cur, indent, [&](StringRef name) {
+    auto arch = getArchType(name);
+    if (arch == Arch::unknown)
+      return false;
+    archs.set(arch);
+    return true;
+  });
+}
+
+bool DirectReader::parseSections(InterfaceFile &file, bool exports) {
+  if (_eof || _indent == 0 || !_line.startswith("- "))
+    return false;
+
+  auto indent = _indent;
+  while (!_eof && _indent == indent && _line.startswith("- ")) {
+    if (!parseSection(file, exports))
+      return false;
+  }
+
+  // The next line has to be a top-level key or the end of the document.
+  return !_eof && _indent == 0;
+}
+
+bool DirectReader::parseSection(InterfaceFile &file, bool exports) {
+  auto line = _line.drop_front(2).ltrim(' ');
+  unsigned column = _indent + (_line.size() - line.size());
+
+  ArchitectureSet archs;
+  int lastKey = SK_Unknown;
+  while (true) {
+    StringRef key, value;
+    if (!splitKey(line, key, value))
+      return false;
+
+    int index = exports ? StringSwitch<int>(key)
+                              .Case("archs", SK_Archs)
+                              .Case("allowable-clients", SK_AllowableClients)
+                              .Case("re-exports", SK_ReexportedLibraries)
+                              .Case("symbols", SK_Symbols)
+                              .Case("objc-classes", SK_ObjCClasses)
+                              .Case("objc-ivars", SK_ObjCInstanceVariables)
+                              .Case("weak-def-symbols", SK_WeakDefSymbols)
+                              .Case("thread-local-symbols",
+                                    SK_ThreadLocalSymbols)
+                              .Default(SK_Unknown)
+                        : StringSwitch<int>(key)
+                              .Case("archs", SK_Archs)
+                              .Case("symbols", SK_Symbols)
+                              .Case("objc-classes", SK_ObjCClasses)
+                              .Case("objc-ivars", SK_ObjCInstanceVariables)
+                              .Case("weak-ref-symbols", SK_WeakRefSymbols)
+                              .Default(SK_Unknown);
+
+    // The architectures have to come first, because the content is added to
+    // the interface file directly. This also rejects unknown and duplicate
+    // keys.
+    if (index <= lastKey || (lastKey == SK_Unknown && index != SK_Archs))
+      return false;
+    lastKey = index;
+
+    auto addSymbol = [&](SymbolType type, SymbolFlags flags) {
+      return [&file, exports, archs, type, flags](StringRef name) {
+        if (exports)
+          file.addExportedSymbol(name, type, flags, archs);
+        else
+          file.addUndefinedSymbol(name, type, flags, archs);
+        return true;
+      };
+    };
+
+    bool success;
+    switch (index) {
+    default:
+      llvm_unreachable("unexpected section key");
+    case SK_Archs:
+      success = parseArchitectures(value, column, archs);
+      break;
+    case SK_AllowableClients:
+      success = parseSequence(value, column, [&](StringRef name) {
+        if (!skip(SkipFlags::AllowableClients))
+          file.addAllowableClient(name.str(), archs);
+        return true;
+      });
+      break;
+    case SK_ReexportedLibraries:
+      success = parseSequence(value, column, [&](StringRef name) {
+        file.addReexportedLibrary(name.str(), archs);
+        return true;
+      });
+      break;
+    case SK_Symbols:
+      success = parseSequence(value, column,
+                              addSymbol(SymbolType::Symbol, SymbolFlags::None));
+      break;
+    case SK_ObjCClasses:
+      success = parseSequence(
+          value, column, addSymbol(SymbolType::ObjCClass, SymbolFlags::None));
+      break;
+    case SK_ObjCInstanceVariables:
+      success = parseSequence(
+          value, column,
+          addSymbol(SymbolType::ObjCInstanceVariable, SymbolFlags::None));
+      break;
+    case SK_WeakDefSymbols:
+      success = parseSequence(
+          value, column,
+          addSymbol(SymbolType::Symbol, SymbolFlags::WeakDefined));
+      break;
+    case SK_ThreadLocalSymbols:
+      success = parseSequence(
+          value, column,
+          addSymbol(SymbolType::Symbol, SymbolFlags::ThreadLocalValue));
+      break;
+    case SK_WeakRefSymbols:
+      success = parseSequence(
+          value, column,
+          addSymbol(SymbolType::Symbol, SymbolFlags::WeakReferenced));
+      break;
+    }
+    if (!success)
+      return false;
+
+    if (_eof || _indent < column)
+      return true;
+    if (_indent > column)
+      return false;
+    line = _line;
+  }
+}
+
+/// \brief Check that the unconsumed part of the buffer doesn't start another
+/// document.
+bool DirectReader::isRemainderOfDocument() const {
+  return !_buffer.startswith("---") &&
+         _buffer.find("\n---") == StringRef::npos;
+}
+
+bool DirectReader::read(InterfaceFile &file) {
+  // Tabs and carriage returns are left to the YAML parser.
+  if (_buffer.find_first_of("\t\r") != StringRef::npos)
+    return false;
+
+  nextLine();
+  if (_eof || _indent != 0 || _line != "--- !tapi-tbd-v2")
+    return false;
+  nextLine();
+
+  // Defaults for the optional keys.
+  file.setCurrentVersion(PackedVersion(1, 0, 0));
+  file.setCompatibilityVersion(PackedVersion(1, 0, 0));
+  file.setSwiftVersion(0);
+  file.setObjCConstraint(ObjCConstraint::Retain_Release);
+  file.setTwoLevelNamespace();
+  file.setApplicationExtensionSafe();
+
+  bool hasArchs = false;
+  bool hasPlatform = false;
+  bool hasInstallName = false;
+  int lastKey = TK_Unknown;
+  while (true) {
+    if (_eof || _indent != 0)
+      return false;
+    if (_line == "...")
+      break;
+
+    StringRef key, value;
+    if (!splitKey(_line, key, value))
+      return false;
+
+    int index = StringSwitch<int>(key)
+                    .Case("archs", TK_Archs)
+                    .Case("uuids", TK_UUIDs)
+                    .Case("platform", TK_Platform)
+                    .Case("flags", TK_Flags)
+                    .Case("install-name", TK_InstallName)
+                    .Case("current-version", TK_CurrentVersion)
+                    .Case("compatibility-version", TK_CompatibilityVersion)
+                    .Case("swift-version", TK_SwiftVersion)
+                    .Case("objc-constraint", TK_ObjCConstraint)
+                    .Case("parent-umbrella", TK_ParentUmbrella)
+                    .Case("exports", TK_Exports)
+                    .Case("undefineds", TK_Undefineds)
+                    .Default(TK_Unknown);
+
+    // This also rejects unknown and duplicate keys.
+    if (index <= lastKey)
+      return false;
+    lastKey = index;
+
+    StringRef scalar;
+    bool success = true;
+    switch (index) {
+    default:
+      llvm_unreachable("unexpected top-level key");
+    case TK_Archs: {
+      ArchitectureSet archs;
+      success = parseArchitectures(value, 0, archs);
+      file.setArchitectures(archs);
+      hasArchs = true;
+      break;
+    }
+    case TK_UUIDs:
+      success = parseSequence(value, 0, [&](StringRef string) {
+        if (skip(SkipFlags::UUIDs))
+          return true;
+        ArchUUID uuid;
+        if (!ScalarTraits<ArchUUID>::input(string, nullptr, uuid).empty())
+          return false;
+        file.addUUID(uuid.first, uuid.second);
+        return true;
+      });
+      break;
+    case TK_Platform: {
+      auto platform = Platform::Unknown;
+      success = parseScalarValue(value, scalar) &&
+                parsePlatform(scalar, platform);
+      file.setPlatform(platform);
+      hasPlatform = true;
+      break;
+    }
+    case TK_Flags:
+      success = parseSequence(value, 0, [&](StringRef flag) {
+        if (flag == "flat_namespace")
+          file.setTwoLevelNamespace(false);
+        else if (flag == "not_app_extension_safe")
+          file.setApplicationExtensionSafe(false);
+        else
+          return false;
+        return true;
+      });
+      break;
+    case TK_InstallName:
+      success = parseScalarValue(value, scalar);
+      file.setInstallName(scalar.str());
+      hasInstallName = true;
+      break;
+    case TK_CurrentVersion: {
+      PackedVersion version;
+      success = parseScalarValue(value, scalar) &&
+                ScalarTraits<PackedVersion>::input(scalar, nullptr, version)
+                    .empty();
+      file.setCurrentVersion(version);
+      break;
+    }
+    case TK_CompatibilityVersion: {
+      PackedVersion version;
+      success = parseScalarValue(value, scalar) &&
+                ScalarTraits<PackedVersion>::input(scalar, nullptr, version)
+                    .empty();
+      file.setCompatibilityVersion(version);
+      break;
+    }
+    case TK_SwiftVersion: {
+      SwiftVersion version(0);
+      success = parseScalarValue(value, scalar) &&
+                ScalarTraits<SwiftVersion>::input(scalar, nullptr, version)
+                    .empty();
+      file.setSwiftVersion(version);
+      break;
+    }
+    case TK_ObjCConstraint: {
+      auto constraint = ObjCConstraint::None;
+      success = parseScalarValue(value, scalar) &&
+                parseObjCConstraint(scalar, constraint);
+      file.setObjCConstraint(constraint);
+      break;
+    }
+    case TK_ParentUmbrella:
+      success = parseScalarValue(value, scalar);
+      file.setParentUmbrella(scalar.str());
+      break;
+    case TK_Exports:
+    case TK_Undefineds:
+      // The symbols are the only content that follows the header keys. Don't
+      // bother to parse the remainder of the document, but still make sure
+      // that it is the only document in the buffer.
+      if (_readFlags == ReadFlags::Header ||
+          (index == TK_Undefineds && skip(SkipFlags::Undefineds)))
+        return isRemainderOfDocument() && hasArchs && hasPlatform &&
+               hasInstallName;
+      if (!value.empty())
+        return false;
+      nextLine();
+      success = parseSections(file, index == TK_Exports);
+      break;
+    }
+    if (!success)
+      return false;
+  }
+
+  // The document has to be the only one in the buffer.
+  nextLine();
+  return _eof && hasArchs && hasPlatform && hasInstallName;
+}
+
+static StringRef getPlatformKey(Platform platform) {
+  switch (platform) {
+  case Platform::Unknown:
+    return "unknown";
+  case Platform::OSX:
+    return "macosx";
+  case Platform::iOS:
+    return "ios";
+  case Platform::watchOS:
+    return "watchos";
+  case Platform::tvOS:
+    return "tvos";
+  }
+  llvm_unreachable("unknown platform");
+}
+
+static StringRef getObjCConstraintKey(ObjCConstraint constraint) {
+  switch (constraint) {
+  case ObjCConstraint::None:
+    return "none";
+  case ObjCConstraint::Retain_Release:
+    return "retain_release";
+  case ObjCConstraint::Retain_Release_For_Simulator:
+    return "retain_release_for_simulator";
+  case ObjCConstraint::Retain_Release_Or_GC:
+    return "retain_release_or_gc";
+  case ObjCConstraint::GC:
+    return "gc";
+  }
+  llvm_unreachable("unknown objc constraint");
+}
+
+void DirectWriter::newLine(unsigned indent) {
+  _os << '\n';
+  _column = 0;
+  for (unsigned i = 0; i < indent; ++i)
+    output("  ");
+}
+
+void DirectWriter::key(StringRef name) {
+  output(name);
+  output(":");
+  static const char spaces[] = "                ";
+  if (name.size() < sizeof(spaces) - 1)
+    output(&spaces[name.size()]);
+  else
+    output(" ");
+}
+
+void DirectWriter::string(StringRef value, bool mustQuote) {
+  if (value.empty()) {
+    output("''");
+    return;
+  }
+
+  if (!mustQuote) {
+    output(value);
+    return;
+  }
+
+  // Single quotes are escaped by doubling them.
+  output("'");
+  size_t start = 0;
+  for (auto end = value.find('\''); end != StringRef::npos;
+       end = value.find('\'', start)) {
+    output(value.slice(start, end + 1));
+    output("'");
+    start = end + 1;
+  }
+  output(value.drop_front(start));
+  output("'");
+}
+
+template <typename T> void DirectWriter::scalar(const T &value) {
+  SmallString<128> storage;
+  raw_svector_ostream os(storage);
+  ScalarTraits<T>::output(value, nullptr, os);
+  string(os.str(), ScalarTraits<T>::mustQuote(os.str()));
+}
+
+void DirectWriter::architectures(ArchitectureSet archs) {
+  output("[ ");
+  bool needsComma = false;
+  for (auto arch : archs) {
+    if (needsComma)
+      output(", ");
+    output(getArchName(arch));
+    needsComma = true;
+  }
+  output(" ]");
+}
+
+void DirectWriter::flags(Flags flags) {
+  output("[ ");
+  if (flags & Flags::FlatNamespace)
+    output("flat_namespace");
+  if (flags & Flags::NotApplicationExtensionSafe) {
+    if (flags & Flags::FlatNamespace)
+      output(", ");
+    output("not_app_extension_safe");
+  }
+  output(" ]");
+}
+
+void DirectWriter::uuids(const std::vector<ArchUUID> &uuids) {
+  auto flowStart = _column;
+  output("[ ");
+  bool needsComma = false;
+  for (const auto &uuid : uuids) {
+    if (needsComma)
+      output(", ");
+    needsComma = true;
+
+    // Wrap the flow sequence once it extends past the wrap column.
+    if (_column > 80) {
+      newLine(0);
+      for (unsigned i = 0; i < flowStart; ++i)
+        output(" ");
+      output("  ");
+    }
+    scalar(uuid);
+  }
+  output(" ]");
+}
+
+void DirectWriter::sequence(StringRef name,
+                            const std::vector<StringRef> &values) {
+  // Empty sequences are omitted.
+  if (values.empty())
+    return;
+
+  key(2, name);
+  for (const auto &value : values) {
+    newLine(3);
+    output("- ");
+    scalar(value);
+  }
+}
+
+void DirectWriter::write(const InterfaceFile &file) {
+  output("--- !tapi-tbd-v2");
+  key(0, "archs");
+  architectures(file.getArchitectures());
+
+  if (!file.uuids().empty()) {
+    key(0, "uuids");
+    uuids(file.uuids());
+  }
+
+  key(0, "platform");
+  output(getPlatformKey(file.getPlatform()));
+
+  auto fileFlags = Flags::None;
+  if (!file.isTwoLevelNamespace())
+    fileFlags |= Flags::FlatNamespace;
+  if (!file.isApplicationExtensionSafe())
+    fileFlags |= Flags::NotApplicationExtensionSafe;
+  if (fileFlags != Flags::None) {
+    key(0, "flags");
+    flags(fileFlags);
+  }
+
+  key(0, "install-name");
+  scalar(file.getInstallName());
+
+  if (!(file.getCurrentVersion() == PackedVersion(1, 0, 0))) {
+    key(0, "current-version");
+    scalar(file.getCurrentVersion());
+  }
+
+  if (!(file.getCompatibilityVersion() == PackedVersion(1, 0, 0))) {
+    key(0, "compatibility-version");
+    scalar(file.getCompatibilityVersion());
+  }
+
+  if (file.getSwiftVersion() != 0) {
+    key(0, "swift-version");
+    scalar(SwiftVersion(file.getSwiftVersion()));
+  }
+
+  if (file.getObjCConstraint() != ObjCConstraint::Retain_Release) {
+    key(0, "objc-constraint");
+    output(getObjCConstraintKey(file.getObjCConstraint()));
+  }
+
+  if (!file.getParentUmbrella().empty()) {
+    key(0, "parent-umbrella");
+    scalar(file.getParentUmbrella());
+  }
+
+  auto exports = getExportSections(file);
+  if (!exports.empty()) {
+    key(0, "exports");
+    for (const auto &section : exports) {
+      newLine(1);
+      output("- ");
+      key("archs");
+      architectures(section.archs);
+      sequence("allowable-clients", section.allowableClients);
+      sequence("re-exports", section.reexportedLibraries);
+      sequence("symbols", section.symbols);
+      sequence("objc-classes", section.classes);
+      sequence("objc-ivars", section.ivars);
+      sequence("weak-def-symbols", section.weakDefSymbols);
+      sequence("thread-local-symbols", section.tlvSymbols);
+    }
+  }
+
+  auto undefineds = getUndefinedSections(file);
+  if (!undefineds.empty()) {
+    key(0, "undefineds");
+    for (const auto &section : undefineds) {
+      newLine(1);
+      output("- ");
+      key("archs");
+      architectures(section.archs);
+      sequence("symbols", section.symbols);
+      sequence("objc-classes", section.classes);
+      sequence("objc-ivars", section.ivars);
+      sequence("weak-ref-symbols", section.weakRefSymbols);
+    }
+  }
+
+  output("\n...\n");
+}
+
+bool TextBasedStubDocumentHandler::canRead(llvm::MemoryBufferRef memBufferRef,
+                                           FileType types) const {
+  if (!(types & FileType::TBD_V2))
+    return false;
+
+  auto tag = getDocumentTag(memBufferRef);
+  return tag && *tag == "!tapi-tbd-v2";
+}
+
 FileType TextBasedStubDocumentHandler::getFileType(
     llvm::MemoryBufferRef memBufferRef) const {
   if (canRead(memBufferRef))
@@ -363,6 +1222,28 @@ bool TextBasedStubDocumentHandler::canWrite(const File *file) const {
   return true;
 }
 
+std::unique_ptr<File>
+TextBasedStubDocumentHandler::readFile(MemoryBufferRef memBufferRef,
+                                       ReadFlags readFlags,
+                                       SkipFlags skipFlags) const {
+  std::unique_ptr<InterfaceFile> file(new InterfaceFile);
+  file->setPath(memBufferRef.getBufferIdentifier());
+  file->setFileType(FileType::TBD_V2);
+
+  DirectReader reader(memBufferRef.getBuffer(), readFlags, skipFlags);
+  if (!reader.read(*file))
+    return nullptr;
+
+  file->finalize();
+  return file;
+}
+
+bool TextBasedStubDocumentHandler::writeFile(raw_ostream &os,
+                                             const File *file) const {
+  DirectWriter(os).write(*cast<InterfaceFile>(file));
+  return true;
+}
+
 bool TextBasedStubDocumentHandler::handleDocument(IO &io,
                                                   const File *&file) const {
   if (io.outputting() && file->getFileType() != FileType::TBD_V2)
@@ -0,0 +1,82 @@
+//===- lib/Core/UUID.cpp - TAPI UUID ----------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the parsing and formatting of UUIDs.
+///
+//===----------------------------------------------------------------------===//
+
+#include "tapi/Core/UUID.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief A dash follows the bytes at these indices in the textual form.
+static bool isFollowedByDash(unsigned index) {
+  return index == 3 || index == 5 || index == 7 || index == 9;
+}
+
+static int getHexDigitValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+bool UUID::parse(StringRef str) {
+  if (str.size() != stringLength)
+    return false;
+
+  uint8_t bytes[size];
+  const char *it = str.begin();
+  for (unsigned i = 0; i < size; ++i) {
+    auto high = getHexDigitValue(*it++);
+    auto low = getHexDigitValue(*it++);
+    if (high < 0 || low < 0)
+      return false;
+    bytes[i] = static_cast<uint8_t>((high << 4) | low);
+
+    if (isFollowedByDash(i) && *it++ != '-')
+      return false;
+  }
+
+  for (unsigned i = 0; i < size; ++i)
+    _bytes[i] = bytes[i];
+  return true;
+}
+
+void UUID::format(char (&buffer)[stringLength]) const {
+  static const char digits[] = "0123456789ABCDEF";
+  char *out = buffer;
+  for (unsigned i = 0; i < size; ++i) {
+    *out++ = digits[_bytes[i] >> 4];
+    *out++ = digits[_bytes[i] & 0xf];
+    if (isFollowedByDash(i))
+      *out++ = '-';
+  }
+}
+
+void UUID::print(raw_ostream &os) const {
+  char buffer[stringLength];
+  format(buffer);
+  os.write(buffer, stringLength);
+}
+
+std::string UUID::str() const {
+  char buffer[stringLength];
+  format(buffer);
+  return std::string(buffer, stringLength);
+}
+
+TAPI_NAMESPACE_INTERNAL_END
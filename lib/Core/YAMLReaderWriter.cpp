@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "tapi/Core/YAMLReaderWriter.h"
+#include "tapi/Core/Instrumentation.h"
 #include "tapi/Core/InterfaceFile.h"
 #include "tapi/Core/Registry.h"
 
@@ -39,7 +40,10 @@ template <> struct MappingTraits<const File *> {
   static void mapping(IO &io, const File *&file) {
     auto ctx = reinterpret_cast<YAMLContext *>(io.getContext());
     assert(ctx != nullptr);
-    ctx->_base.handleDocument(io, file);
+    if (ctx->_handler != nullptr)
+      ctx->_handler->handleDocument(io, file);
+    else
+      ctx->_base.handleDocument(io, file);
   }
 };
 }
@@ -61,21 +65,57 @@ static void DiagHandler(const SMDiagnostic &diag, void *context) {
   file->_errorMessage = message.str();
 }
 
+Optional<StringRef> getDocumentTag(MemoryBufferRef memBufferRef) {
+  if (!memBufferRef.getBufferIdentifier().endswith(".tbd"))
+    return None;
+
+  auto str = memBufferRef.getBuffer().ltrim();
+  if (!str.startswith("---") || !str.rtrim().endswith("..."))
+    return None;
+
+  str = str.drop_front(3);
+  if (str.startswith("\n"))
+    return StringRef();
+
+  if (!str.startswith(" "))
+    return None;
+
+  auto end = str.find('\n');
+  if (end == StringRef::npos)
+    return None;
+
+  auto tag = str.slice(1, end);
+  if (tag.empty())
+    return None;
+
+  return tag;
+}
+
 bool TextBasedStubBase::canRead(MemoryBufferRef memBufferRef,
                                 FileType types) const {
+  return findHandler(memBufferRef, types) != nullptr;
+}
+
+const DocumentHandler *
+TextBasedStubBase::findHandler(MemoryBufferRef memBufferRef,
+                              FileType types) const {
   for (const auto &handler : _documentHandlers) {
     if (handler->canRead(memBufferRef, types))
-      return true;
+      return handler.get();
   }
-  return false;
+  return nullptr;
 }
 
-bool TextBasedStubBase::canWrite(const File *file) const {
+const DocumentHandler *TextBasedStubBase::findHandler(const File *file) const {
   for (const auto &handler : _documentHandlers) {
     if (handler->canWrite(file))
-      return true;
+      return handler.get();
   }
-  return false;
+  return nullptr;
+}
+
+bool TextBasedStubBase::canWrite(const File *file) const {
+  return findHandler(file) != nullptr;
 }
 
 FileType TextBasedStubBase::getFileType(MemoryBufferRef bufferRef) const {
@@ -106,10 +146,40 @@ FileType TextBasedStubReader::getFileType(file_magic magic,
   return TextBasedStubBase::getFileType(memBufferRef);
 }
 
+/// \brief Record the size and the number of symbols of a successfully read
+/// file.
+static void recordRead(MemoryBufferRef memBuffer, const File *file) {
+  if (!Instrumentation::isEnabled() || file->getErrorCode())
+    return;
+
+  Instrumentation::add(Instrumentation::Counter::TextFilesRead, 1);
+  Instrumentation::add(Instrumentation::Counter::BytesRead,
+                       memBuffer.getBufferSize());
+  if (const auto *interface = dyn_cast<InterfaceFile>(file))
+    Instrumentation::add(Instrumentation::Counter::SymbolsRead,
+                         interface->exports().size() +
+                             interface->undefineds().size());
+}
+
 std::unique_ptr<File>
-TextBasedStubReader::readFile(MemoryBufferRef memBuffer) const {
+TextBasedStubReader::readFile(MemoryBufferRef memBuffer, ReadFlags readFlags,
+                              SkipFlags skipFlags) const {
+  const auto *handler = findHandler(memBuffer, FileType::All);
+  if (handler == nullptr)
+    return nullptr;
+
+  Instrumentation::Timer timer(Instrumentation::Phase::Parse);
+
+  // Try to read the document directly first.
+  if (auto file = handler->readFile(memBuffer, readFlags, skipFlags)) {
+    recordRead(memBuffer, file.get());
+    return file;
+  }
+
   // Create YAML Input Reader.
   YAMLContext ctx(*this);
+  ctx._handler = handler;
+  ctx._skipFlags = skipFlags;
   ctx._path = memBuffer.getBufferIdentifier();
   llvm::yaml::Input yin(memBuffer.getBuffer(), &ctx, DiagHandler, &ctx);
 
@@ -124,6 +194,7 @@ TextBasedStubReader::readFile(MemoryBufferRef memBuffer) const {
     file->setErrorCode(yin.error());
     file->setParsingError(ctx._errorMessage);
   }
+  recordRead(memBuffer, file);
   return std::unique_ptr<File>(file);
 }
 
@@ -135,21 +206,33 @@ std::error_code TextBasedStubWriter::writeFile(const File *file) const {
   if (file == nullptr)
     return std::make_error_code(std::errc::invalid_argument);
 
-  // Create YAML Output Writer.
   std::error_code ec;
-
   raw_fd_ostream out(file->getPath(), ec, sys::fs::F_Text);
   if (ec)
     return ec;
 
+  return writeFile(out, file);
+}
+
+std::error_code TextBasedStubWriter::writeFile(raw_ostream &os,
+                                               const File *file) const {
+  if (file == nullptr)
+    return std::make_error_code(std::errc::invalid_argument);
+
+  // Try to write the document directly first.
+  const auto *handler = findHandler(file);
+  if (handler != nullptr && handler->writeFile(os, file))
+    return std::error_code();
+
+  // Create YAML Output Writer.
   YAMLContext ctx(*this);
   ctx._path = file->getPath();
-  llvm::yaml::Output yout(out, &ctx, /*WrapColumn=*/80);
+  llvm::yaml::Output yout(os, &ctx, /*WrapColumn=*/80);
 
   // Stream out yaml.
   yout << file;
 
-  return ec;
+  return std::error_code();
 }
 
 TAPI_NAMESPACE_INTERNAL_END
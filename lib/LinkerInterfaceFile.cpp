@@ -11,59 +11,59 @@
 /// \brief Implements the C++ linker interface file API.
 ///
 //===----------------------------------------------------------------------===//
+#include "tapi/Core/CompiledStub.h"
+#include "tapi/Core/Instrumentation.h"
 #include "tapi/Core/InterfaceFile.h"
+#include "tapi/Core/InterfaceFileCache.h"
 #include "tapi/Core/LLVM.h"
+#include "tapi/Core/LinkerDirectives.h"
+#include "tapi/Core/Parallel.h"
+#include "tapi/Core/ReexportResolver.h"
 #include "tapi/Core/Registry.h"
 #include "tapi/Core/STLExtras.h"
-#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Object/MachO.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <system_error>
 #include <tapi/LinkerInterfaceFile.h>
 #include <tapi/PackedVersion32.h>
+#include <thread>
 #include <vector>
 
 TAPI_NAMESPACE_V1_BEGIN
 
 using namespace tapi::internal;
 
-static PackedVersion32 parseVersion32(StringRef str) {
-  uint32_t version = 0;
-  if (str.empty())
-    return 0;
-
-  SmallVector<StringRef, 3> parts;
-  SplitString(str, parts, ".");
-
-  unsigned long long num = 0;
-  if (getAsUnsignedInteger(parts[0], 10, num))
-    return 0;
-
-  if (num > UINT16_MAX)
-    return 0;
-
-  version = num << 16;
-
-  if (parts.size() > 1) {
-    if (getAsUnsignedInteger(parts[1], 10, num))
-      return 0;
-
-    if (num > UINT8_MAX)
-      return 0;
-
-    version |= (num << 8);
+/// \brief Splits an Objective-C linker symbol name into the name and type of
+/// the symbol in the interface file.
+static bool splitObjCSymbolName(StringRef name, bool useObjC1ABI,
+                                StringRef &rest, SymbolType &type) {
+  rest = name;
+  if (useObjC1ABI) {
+    if (rest.consume_front(".objc_class_name")) {
+      type = SymbolType::ObjCClass;
+      return true;
+    }
+  } else {
+    if (rest.consume_front("_OBJC_CLASS_$") ||
+        rest.consume_front("_OBJC_METACLASS_$")) {
+      type = SymbolType::ObjCClass;
+      return true;
+    }
   }
 
-  if (parts.size() > 2) {
-    if (getAsUnsignedInteger(parts[2], 10, num))
-      return 0;
-
-    if (num > UINT8_MAX)
-      return 0;
-
-    version |= num;
+  if (rest.consume_front("_OBJC_IVAR_$")) {
+    type = SymbolType::ObjCInstanceVariable;
+    return true;
   }
 
-  return version;
+  return false;
 }
 
 class LinkerInterfaceFile::Impl {
@@ -81,69 +81,560 @@ public:
   bool _isAppExtensionSafe;
   bool _hasWeakDefExports;
   bool _installPathOverride;
+  bool _skipUndefineds;
 
   std::vector<std::string> _reexportedLibraries;
   std::vector<std::string> _allowableClients;
   std::vector<std::string> _ignoreExports;
-  std::vector<Symbol> _exports;
-  std::vector<Symbol> _undefineds;
+
+  /// The parsed interface file and the architecture slice this file
+  /// represents. Symbol lookups are answered directly from the parsed file.
+  std::shared_ptr<const ParsedInterfaceFile> _parsed;
+  const InterfaceFile *_interface;
+  Arch _arch;
+
+  /// A file that doesn't share the parsed file with the cache or other files
+  /// can release it on request, and answers the lookups from its own lists
+  /// and a copy of the export filter from then on.
+  bool _isReleased;
+  std::unique_ptr<ParsedInterfaceFile::Slice> _ownedSlice;
+  ExportFilter _exportFilter;
+
+  /// The fingerprint is only computed on demand. A released file only knows
+  /// it if it had been computed before the release.
+  mutable std::once_flag _fingerprintFlag;
+  mutable Fingerprint _fingerprint;
+  mutable std::atomic<bool> _hasFingerprint;
+
+  /// The exports the lookups are answered from once the parsed file has been
+  /// released. The exports added by the $ld$ directives start at the index,
+  /// and the symbols before and after them are sorted by name.
+  const std::vector<Symbol> *_lookupExports;
+  size_t _ldExportsBegin;
+
+  /// The symbols hidden by the $ld$ directives, sorted by name. The names
+  /// reference the parsed file, so that lookups keep working after the list of
+  /// ignored exports has been taken.
+  std::vector<StringRef> _hiddenNames;
+
+  /// Exports that are the result of processing the $ld$ symbols.
+  std::vector<Symbol> _ldExports;
+  llvm::StringMap<SymbolFlags> _ldExportIndex;
+
+  /// The export and undefined lists are only materialized on first use. They
+  /// are shared with all files for the same slice, unless the $ld$ directives
+  /// changed the exports. Once a list has been taken, it is replaced by the
+  /// empty list.
+  std::once_flag _sliceFlag;
+  std::once_flag _exportsFlag;
+  const ParsedInterfaceFile::Slice *_slice;
+  const std::vector<Symbol> *_exports;
+  const std::vector<Symbol> *_undefineds;
+  std::vector<Symbol> _adjustedExports;
+  const std::vector<Symbol> _noSymbols;
 
   Impl() noexcept : _fileType(FileType::Unsupported),
                     _platform(Platform::Unknown),
                     _hasTwoLevelNamespace(false),
                     _isAppExtensionSafe(false),
                     _hasWeakDefExports(false),
-                    _installPathOverride(false) {}
-
-  template <typename T> void addSymbol(T &&sym, PackedVersion32 minOSVersion) {
-    // $ld$ <action> $ <condition> $ <symbol-name>
-    StringRef name = sym.getName();
-    if (name.startswith("$ld$")) {
-      StringRef action, condition, symbolName;
-      std::tie(action, name) = name.drop_front(4).split('$');
-      std::tie(condition, symbolName) = name.split('$');
-      if (action.empty() || condition.empty() || symbolName.empty())
-        return;
+                    _installPathOverride(false),
+                    _skipUndefineds(false),
+                    _interface(nullptr),
+                    _arch(Arch::unknown),
+                    _isReleased(false),
+                    _hasFingerprint(false),
+                    _lookupExports(nullptr),
+                    _ldExportsBegin(0),
+                    _slice(nullptr),
+                    _exports(nullptr),
+                    _undefineds(nullptr) {}
+
+  static LinkerInterfaceFile *
+  create(InterfaceFileCache::FilePtr parsed, Arch arch, ParsingFlags flags,
+         PackedVersion32 minOSVersion);
+
+  void addLdExport(StringRef name, SymbolFlags flags) {
+    _ldExports.emplace_back(name.str(), flags);
+    _ldExportIndex.insert(std::make_pair(name, flags));
+  }
 
-      if (!condition.startswith("os"))
-        return;
+  void applyLinkerDirective(const LinkerDirectives::Directive &directive) {
+    switch (directive.action) {
+    case LinkerDirectives::Action::Hide:
+      _hiddenNames.emplace_back(directive.name);
+      return;
+    case LinkerDirectives::Action::Add:
+      addLdExport(directive.name, directive.flags);
+      return;
+    case LinkerDirectives::Action::InstallName:
+      _installName = directive.name;
+      _installPathOverride = true;
+      if (_installName == "/System/Library/Frameworks/"
+                          "ApplicationServices.framework/Versions/A/"
+                          "ApplicationServices") {
+        _compatibilityVersion = PackedVersion32(1, 0, 0);
+      }
+      return;
+    case LinkerDirectives::Action::CompatibilityVersion:
+      _compatibilityVersion = directive.version;
+      return;
+    case LinkerDirectives::Action::Unknown:
+      // Unknown actions are exported as is.
+      if (find(_hiddenNames, directive.name) == _hiddenNames.end())
+        addLdExport(directive.name, directive.flags);
+      return;
+    }
+  }
 
-      auto version = parseVersion32(condition.drop_front(2));
-      if (version != minOSVersion)
-        return;
+  /// Release the parsed file unless it is shared. The exports are materialized
+  /// first, because the lookups are answered from them afterwards. Nobody else
+  /// can obtain a reference to a parsed file that isn't shared, so the use
+  /// count can't increase in the meantime.
+  void releaseParsedFile() {
+    if (_isReleased || _parsed.use_count() != 1)
+      return;
+
+    // The lookups of a file whose exports have been taken keep using the
+    // parsed file.
+    if (&getExports() == &_noSymbols)
+      return;
+
+    _exportFilter = _parsed->getExportFilter();
+    takeSlice();
+    _lookupExports = _exports;
+
+    // The $ld$ directives changed the exports, so the unchanged exports of
+    // the slice are no longer needed.
+    if (_exports != &_ownedSlice->exports)
+      _ownedSlice->exports = std::vector<Symbol>();
+    _isReleased = true;
+
+    // The hidden names reference the parsed file, but they were only needed
+    // for the lookups in the parsed file.
+    _hiddenNames = std::vector<StringRef>();
+    _interface = nullptr;
+    _parsed.reset();
+  }
 
-      if (action == "hide") {
-        _ignoreExports.emplace_back(symbolName);
-        return;
-      }
+  /// Take the slice from a parsed file that isn't shared. The slice stays
+  /// where it is, only its owner changes, so the published slice remains
+  /// valid.
+  void takeSlice() {
+    if (_ownedSlice != nullptr)
+      return;
+    getSlice();
+    _ownedSlice = _parsed->takeSlice(_arch);
+    assert(_ownedSlice.get() == _slice && "the slice has been replaced");
+  }
 
-      if (action == "add") {
-        _exports.emplace_back(symbolName, sym.getFlags());
-        return;
-      }
+  bool findMaterializedExport(StringRef name, SymbolFlags &flags) const {
+    const auto &symbols = *_lookupExports;
+    auto search = [&](size_t begin, size_t end) {
+      auto it = std::lower_bound(symbols.begin() + begin,
+                                 symbols.begin() + end, name,
+                                 [](const Symbol &symbol, StringRef name) {
+                                   return symbol.getName() < name;
+                                 });
+      if (it == symbols.begin() + end || it->getName() != name)
+        return false;
+      flags = it->getFlags();
+      return true;
+    };
+
+    return search(0, _ldExportsBegin) ||
+           search(_ldExportsBegin + _ldExports.size(), symbols.size());
+  }
 
-      if (action == "install_name") {
-        _installName = symbolName;
-        _installPathOverride = true;
-        if (_installName == "/System/Library/Frameworks/"
-                            "ApplicationServices.framework/Versions/A/"
-                            "ApplicationServices") {
-          _compatibilityVersion = PackedVersion32(1, 0, 0);
-        }
-        return;
-      }
+  bool isIgnored(StringRef name) const {
+    return std::binary_search(_hiddenNames.begin(), _hiddenNames.end(), name);
+  }
 
-      if (action == "compatibility_version") {
-        _compatibilityVersion = parseVersion32(symbolName);
-        return;
-      }
+  const ParsedInterfaceFile::Slice &getSlice() {
+    std::call_once(_sliceFlag,
+                   [this] { _slice = &_parsed->getSlice(_arch); });
+    return *_slice;
+  }
+
+  const std::vector<Symbol> &getExports() {
+    std::call_once(_exportsFlag, [this] { adjustExports(); });
+    return *_exports;
+  }
+
+  const std::vector<Symbol> &getUndefineds() {
+    if (_undefineds != nullptr)
+      return *_undefineds;
+    return getSlice().undefineds;
+  }
+
+  /// Hand the exports over if this file owns them and the lookups don't
+  /// depend on them. The lookups of a file whose exports have been taken keep
+  /// using the parsed file, so it is never released.
+  bool takeExports(std::vector<Symbol> &exports) {
+    std::call_once(_exportsFlag, [this] {
+      if (_parsed.use_count() == 1 && _ldExports.empty() &&
+          _hiddenNames.empty())
+        takeSlice();
+      adjustExports();
+    });
+
+    if (_exports == &_noSymbols) {
+      exports.clear();
+      return true;
+    }
+
+    // A released file answers the lookups from its exports.
+    if (_isReleased)
+      return false;
+
+    if (_exports == &_adjustedExports)
+      exports = std::move(_adjustedExports);
+    else if (_ownedSlice != nullptr && _exports == &_ownedSlice->exports)
+      exports = std::move(_ownedSlice->exports);
+    else
+      return false;
+    _exports = &_noSymbols;
+    return true;
+  }
+
+  /// Hand the undefineds over if this file owns them or can take the slice.
+  /// The lookups never depend on them.
+  bool takeUndefineds(std::vector<Symbol> &undefineds) {
+    if (_undefineds == &_noSymbols) {
+      undefineds.clear();
+      return true;
+    }
+
+    if (_ownedSlice == nullptr) {
+      if (_parsed.use_count() != 1)
+        return false;
+      takeSlice();
+    }
+    undefineds = std::move(_ownedSlice->undefineds);
+    _undefineds = &_noSymbols;
+    return true;
+  }
+
+  /// Point the exports at the list of the slice, or at the adjusted list if
+  /// the $ld$ directives changed the exports.
+  void adjustExports() {
+    const auto &symbols = getSlice().exports;
+    if (_ldExports.empty() && _hiddenNames.empty()) {
+      _exports = &symbols;
+      return;
+    }
+
+    Instrumentation::Timer timer(Instrumentation::Phase::LinkerDirectives);
+
+    // The $ld$ symbols are processed in sorted order, which means only the
+    // symbols that sort after them are subject to the hide directives.
+    auto mid = std::lower_bound(symbols.begin(), symbols.end(), "$ld$",
+                                [](const Symbol &symbol, StringRef name) {
+                                  return symbol.getName() < name;
+                                });
+    _adjustedExports.reserve(symbols.size() + _ldExports.size());
+    _adjustedExports.insert(_adjustedExports.end(), symbols.begin(), mid);
+    _adjustedExports.insert(_adjustedExports.end(), _ldExports.cbegin(),
+                            _ldExports.cend());
+    for (auto it = mid, ie = symbols.end(); it != ie; ++it)
+      if (!isIgnored(it->getName()))
+        _adjustedExports.emplace_back(*it);
+    _exports = &_adjustedExports;
+    _ldExportsBegin = mid - symbols.begin();
+  }
+
+  bool useObjC1ABI() const {
+    return _platform == Platform::OSX && _arch == Arch::i386;
+  }
+
+  std::string getFingerprint() const {
+    if (_isReleased)
+      return _hasFingerprint ? _fingerprint.str() : std::string();
+
+    std::call_once(_fingerprintFlag, [this] {
+      _fingerprint = _interface->getFingerprint();
+      _hasFingerprint = true;
+    });
+    return _fingerprint.str();
+  }
+
+  /// Visits the same symbols as adjustExports, but in the order of the parsed
+  /// file.
+  void visitExports(const SymbolVisitor &visitor) const {
+    if (_isReleased) {
+      for (const auto &symbol : *_lookupExports)
+        visitor(symbol.getName().data(), symbol.getName().size(),
+                symbol.getFlags());
+      return;
     }
 
-    if (find(_ignoreExports, sym.getName()) == _ignoreExports.end())
-      _exports.emplace_back(std::forward<T>(sym));
+    for (const auto &symbol : _ldExports)
+      visitor(symbol.getName().data(), symbol.getName().size(),
+              symbol.getFlags());
+
+    std::string buffer;
+    for (const auto &symbol : _interface->exports()) {
+      if (!symbol.hasArch(_arch))
+        continue;
+      if (symbol.isSymbol() && symbol.getName().startswith("$ld$"))
+        continue;
+      ParsedInterfaceFile::forEachLinkerName(
+          symbol, useObjC1ABI(), buffer, [&](StringRef name) {
+            if (name > "$ld$" && isIgnored(name))
+              return;
+            visitor(name.data(), name.size(), symbol.getFlags());
+          });
+    }
+  }
+
+  void visitUndefineds(const SymbolVisitor &visitor) const {
+    if (_skipUndefineds || _undefineds == &_noSymbols)
+      return;
+
+    if (_isReleased) {
+      for (const auto &symbol : _ownedSlice->undefineds)
+        visitor(symbol.getName().data(), symbol.getName().size(),
+                symbol.getFlags());
+      return;
+    }
+
+    std::string buffer;
+    for (const auto &symbol : _interface->undefineds()) {
+      if (!symbol.hasArch(_arch))
+        continue;
+      ParsedInterfaceFile::forEachLinkerName(
+          symbol, useObjC1ABI(), buffer, [&](StringRef name) {
+            visitor(name.data(), name.size(), symbol.getFlags());
+          });
+    }
+  }
+
+  bool getObjCSymbol(StringRef name, StringRef &rest, SymbolType &type) const {
+    return splitObjCSymbolName(name, useObjC1ABI(), rest, type);
+  }
+
+  bool mayExport(StringRef name) const {
+    if (!_ldExportIndex.empty() && _ldExportIndex.count(name))
+      return true;
+
+    const auto &filter = getExportFilter();
+    if (filter.mayContain(name))
+      return true;
+
+    StringRef rest;
+    SymbolType type;
+    return getObjCSymbol(name, rest, type) && filter.mayContain(rest);
+  }
+
+  /// A released file keeps a copy of the export filter of the parsed file.
+  const ExportFilter &getExportFilter() const {
+    if (_isReleased)
+      return _exportFilter;
+    return _parsed->getExportFilter();
+  }
+
+  bool findExport(StringRef name, SymbolFlags &flags) const {
+    auto ldIt = _ldExportIndex.find(name);
+    if (ldIt != _ldExportIndex.end()) {
+      flags = ldIt->second;
+      return true;
+    }
+
+    if (name.startswith("$ld$"))
+      return false;
+
+    // Most lookups are misses, which the filter rejects without searching
+    // the exports.
+    if (_isReleased)
+      return mayExport(name) && findMaterializedExport(name, flags);
+
+    if (name > "$ld$" && isIgnored(name))
+      return false;
+
+    const auto &filter = getExportFilter();
+    auto lookup = [&](StringRef name, SymbolType type) {
+      if (!filter.mayContain(name))
+        return false;
+      const auto *symbol = _interface->exports().find(name, type);
+      if (symbol == nullptr || !symbol->hasArch(_arch))
+        return false;
+      flags = symbol->getFlags();
+      return true;
+    };
+
+    if (lookup(name, SymbolType::Symbol))
+      return true;
+
+    StringRef rest;
+    SymbolType type;
+    return getObjCSymbol(name, rest, type) && lookup(rest, type);
   }
 };
 
+/// \brief The registry for reading text-based stub files.
+///
+/// The registry and its readers are immutable once constructed and can be
+/// shared by all threads.
+static const Registry &getTextBasedStubRegistry() {
+  static const Registry registry = [] {
+    Registry registry;
+    registry.addYAMLReaders();
+    return registry;
+  }();
+  return registry;
+}
+
+/// \brief The registry for reading text-based stub and MachO files.
+static const Registry &getRegistry() {
+  static const Registry registry = [] {
+    Instrumentation::initialize();
+    Registry registry;
+    registry.addYAMLReaders();
+    registry.addBinaryReaders();
+    return registry;
+  }();
+  return registry;
+}
+
+static InterfaceFileCache &getParsedFileCache() {
+  static InterfaceFileCache cache;
+  return cache;
+}
+
+/// \brief Check if the byte following the buffer can be read and is a null
+/// byte.
+///
+/// This is only safe if the caller guarantees that the memory is readable up to
+/// the end of the page, which is the case for memory mapped files.
+static bool isNullTerminatedInPlace(const uint8_t *data, size_t size) {
+  static const auto pageSize = llvm::sys::Process::getPageSize();
+  auto end = reinterpret_cast<uintptr_t>(data + size);
+  if ((end & (pageSize - 1)) == 0)
+    return false;
+
+  return data[size] == 0;
+}
+
+/// \brief Select the sections the file is read without.
+static SkipFlags getSkipFlags(ParsingFlags flags) {
+  // The UUIDs are never exposed by the linker interface file.
+  auto skipFlags = SkipFlags::UUIDs;
+  if ((flags & ParsingFlags::SkipUndefineds) != ParsingFlags::None)
+    skipFlags |= SkipFlags::Undefineds;
+  if ((flags & ParsingFlags::SkipAllowableClients) != ParsingFlags::None)
+    skipFlags |= SkipFlags::AllowableClients;
+  return skipFlags;
+}
+
+static std::unique_ptr<const InterfaceFile>
+parseTextBasedStubFile(const std::string &path, const uint8_t *data,
+                       size_t size, ParsingFlags flags, SkipFlags skipFlags,
+                       std::string &errorMessage) {
+  auto content = StringRef(reinterpret_cast<const char *>(data), size);
+
+  // The YAML parser relies on the buffer being null-terminated. Mmap
+  // guarantees that pages are padded with zeros, so the buffer can be used in
+  // place if the caller promises that it has been mapped that way, unless the
+  // file size is exactly a multiple of the page size. Otherwise use a copy.
+  std::unique_ptr<llvm::MemoryBuffer> input;
+  if ((flags & ParsingFlags::NullTerminatedBuffer) == ParsingFlags::None ||
+      !isNullTerminatedInPlace(data, size)) {
+    Instrumentation::Timer timer(Instrumentation::Phase::Copy);
+    input = llvm::MemoryBuffer::getMemBufferCopy(content, path);
+  } else
+    input = llvm::MemoryBuffer::getMemBuffer(content, path,
+                                             /*RequiresNullTerminator=*/true);
+
+  const auto &registry = getTextBasedStubRegistry();
+  auto textFile =
+      registry.readFile(input->getMemBufferRef(), ReadFlags::All, skipFlags);
+  if (textFile == nullptr) {
+    errorMessage = "unsupported file type";
+    return nullptr;
+  }
+
+  if (textFile->getErrorCode()) {
+    errorMessage = "malformed file\n" + textFile->getParsingError();
+    return nullptr;
+  }
+
+  // The parsed file is shared with other threads through the cache.
+  auto *interface = cast<InterfaceFile>(textFile.release());
+  interface->freeze();
+  return std::unique_ptr<const InterfaceFile>(interface);
+}
+
+/// \brief Read the compiled stub file that belongs to the text-based stub file,
+/// but only if it has been compiled from the same content.
+static InterfaceFileCache::FilePtr
+readCompiledStubFile(const std::string &path, StringRef content,
+                     SkipFlags skipFlags, uint64_t &hash) {
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(
+      getCompiledStubPath(path), /*FileSize=*/-1,
+      /*RequiresNullTerminator=*/false);
+  if (!bufferOrErr)
+    return nullptr;
+
+  // The hash is only computed on demand.
+  if (hash == 0)
+    hash = InterfaceFileCache::computeHash(content);
+
+  auto bufferRef = bufferOrErr.get()->getMemBufferRef();
+  if (!CompiledStubReader::isCompiledFrom(bufferRef, hash, content.size()))
+    return nullptr;
+
+  auto file =
+      CompiledStubReader().readFile(bufferRef, ReadFlags::All, skipFlags);
+  if (file == nullptr || file->getErrorCode())
+    return nullptr;
+
+  file->setPath(path);
+  auto *interface = cast<InterfaceFile>(file.release());
+  interface->freeze();
+  return std::make_shared<ParsedInterfaceFile>(
+      std::unique_ptr<const InterfaceFile>(interface),
+      CompiledStubReader::readExportFilter(bufferRef));
+}
+
+static InterfaceFileCache::FilePtr
+readTextBasedStubFile(const std::string &path, const uint8_t *data,
+                      size_t size, ParsingFlags flags,
+                      std::string &errorMessage) {
+  Instrumentation::initialize();
+
+  auto content = StringRef(reinterpret_cast<const char *>(data), size);
+  auto skipFlags = getSkipFlags(flags);
+  auto &cache = getParsedFileCache();
+  InterfaceFileCache::Key key;
+  if (cache.isEnabled()) {
+    key = InterfaceFileCache::Key::get(content);
+    if (auto parsed = cache.lookup(path, key, skipFlags))
+      return parsed;
+  }
+
+  // Prefer an up-to-date compiled stub file if requested, which doesn't
+  // require tokenizing and sorting the symbols.
+  if ((flags & ParsingFlags::PreferCompiledStub) != ParsingFlags::None) {
+    if (auto parsed =
+            readCompiledStubFile(path, content, skipFlags, key.hash)) {
+      if (cache.isEnabled())
+        cache.insert(path, key, parsed, skipFlags);
+      return parsed;
+    }
+  }
+
+  auto interface =
+      parseTextBasedStubFile(path, data, size, flags, skipFlags, errorMessage);
+  if (interface == nullptr)
+    return nullptr;
+
+  auto parsed = std::make_shared<ParsedInterfaceFile>(std::move(interface));
+  if (cache.isEnabled())
+    cache.insert(path, key, parsed, skipFlags);
+
+  return parsed;
+}
+
 static Arch getArchForCPU(cpu_type_t cpuType, cpu_subtype_t cpuSubType,
                           bool enforceCpuSubType, ArchitectureSet archs) {
   // First check the exact cpu type and cpu sub type.
@@ -174,8 +665,7 @@ LinkerInterfaceFile::getSupportedFileExtensions() noexcept {
 bool LinkerInterfaceFile::isSupported(const std::string &path,
                                       const uint8_t *data,
                                       size_t size) noexcept {
-  Registry registry;
-  registry.addYAMLReaders();
+  const auto &registry = getTextBasedStubRegistry();
   auto memBuffer = llvm::MemoryBufferRef(
       StringRef(reinterpret_cast<const char *>(data), size), path);
   return registry.canRead(memBuffer);
@@ -188,15 +678,15 @@ bool LinkerInterfaceFile::shouldPreferTextBasedStubFile(
 
 bool LinkerInterfaceFile::areEquivalent(const std::string &tbdPath,
                                         const std::string &dylibPath) noexcept {
-  Registry registry;
-  registry.addYAMLReaders();
-  registry.addBinaryReaders();
+  const auto &registry = getRegistry();
 
   auto tbdErrorOr = llvm::MemoryBuffer::getFile(tbdPath);
   if (tbdErrorOr.getError())
     return false;
 
-  auto textFile = registry.readFile(tbdErrorOr.get()->getMemBufferRef());
+  // Only the UUIDs are compared, so there is no need to read the symbols.
+  auto textFile = registry.readFile(tbdErrorOr.get()->getMemBufferRef(),
+                                    ReadFlags::Header);
   if (textFile == nullptr)
     return false;
 
@@ -211,7 +701,8 @@ bool LinkerInterfaceFile::areEquivalent(const std::string &tbdPath,
   if (machoErrorOr.getError())
     return false;
 
-  auto machoFile = registry.readFile(machoErrorOr.get()->getMemBufferRef());
+  auto machoFile = registry.readFile(machoErrorOr.get()->getMemBufferRef(),
+                                     ReadFlags::Header);
   if (machoFile == nullptr)
     return false;
 
@@ -225,66 +716,212 @@ bool LinkerInterfaceFile::areEquivalent(const std::string &tbdPath,
   return equal(tbdFile->uuids(), dylibFile->uuids());
 }
 
-LinkerInterfaceFile *LinkerInterfaceFile::create(
+std::string LinkerInterfaceFile::getInterfaceFingerprint(
     const std::string &path, const uint8_t *data, size_t size,
-    cpu_type_t cpuType, cpu_subtype_t cpuSubType,
-    CpuSubTypeMatching matchingMode, PackedVersion32 minOSVersion,
     std::string &errorMessage) noexcept {
   if (path.empty() || data == nullptr || size < 8) {
     errorMessage = "invalid argument";
-    return nullptr;
+    return std::string();
   }
 
-  // Use a copy to make sure the buffer is null-terminated (the YAML parser
-  // relies on that). Mmap guarantees that pages are padded with zeros, so
-  // this mostly works, but it breaks down when a TBD file size is exactly
-  // a multiple of the page size.
-  // We could make the copy conditional on the file size, but as we're going
-  // to read it completely anyway, I doubt there's any real performance
-  // benefit to balance the added complexity.
-  auto input = llvm::MemoryBuffer::getMemBufferCopy(
+  // The fingerprint doesn't cover the undefined symbols, UUIDs and clients.
+  const auto skipFlags =
+      SkipFlags::Undefineds | SkipFlags::UUIDs | SkipFlags::AllowableClients;
+
+  // Text-based stub files need a null-terminated buffer, so they are read the
+  // same way as for create(). Only MachO files are read in place.
+  if (isSupported(path, data, size)) {
+    auto interface = parseTextBasedStubFile(path, data, size,
+                                            ParsingFlags::None, skipFlags,
+                                            errorMessage);
+    if (interface == nullptr)
+      return std::string();
+    return interface->getFingerprint().str();
+  }
+
+  const auto &registry = getRegistry();
+  auto memBuffer = llvm::MemoryBufferRef(
       StringRef(reinterpret_cast<const char *>(data), size), path);
+  auto file = registry.readFile(memBuffer, ReadFlags::All, skipFlags);
+  if (file == nullptr) {
+    errorMessage = "unsupported file type";
+    return std::string();
+  }
 
-  Registry registry;
-  registry.addYAMLReaders();
+  if (file->getErrorCode()) {
+    errorMessage = "malformed file\n" + file->getParsingError();
+    return std::string();
+  }
 
-  auto textFile = registry.readFile(input->getMemBufferRef());
-  if (textFile == nullptr) {
+  auto *interface = dyn_cast<InterfaceFile>(file.get());
+  if (interface == nullptr) {
     errorMessage = "unsupported file type";
-    return nullptr;
+    return std::string();
   }
 
-  if (textFile->getErrorCode()) {
-    errorMessage = "malformed file\n" + textFile->getParsingError();
-    return nullptr;
+  return interface->getFingerprint().str();
+}
+
+bool LinkerInterfaceFile::writeCompiledStubFile(
+    const std::string &path, const uint8_t *data, size_t size,
+    std::string &errorMessage) noexcept {
+  if (path.empty() || data == nullptr || size < 8) {
+    errorMessage = "invalid argument";
+    return false;
   }
 
-  auto interface = cast<InterfaceFile>(textFile.get());
-  bool enforceCpuSubType = matchingMode == CpuSubTypeMatching::Exact;
-  auto arch = getArchForCPU(cpuType, cpuSubType, enforceCpuSubType,
-                            interface->getArchitectures());
-  if (arch == Arch::unknown) {
-    auto arch = getArchType(cpuType, cpuSubType);
-    auto count = interface->getArchitectures().count();
-    if (count > 1)
-      errorMessage = "missing required architecture " +
-                     getArchName(arch).str() + " in file " + path + " (" +
-                     std::to_string(count) + " slices)";
-    else
-      errorMessage = "missing required architecture " +
-                     getArchName(arch).str() + " in file " + path;
-    return nullptr;
+  // Always parse the text-based stub file, even if there is already a
+  // compiled stub file for it.
+  auto interface = parseTextBasedStubFile(path, data, size, ParsingFlags::None,
+                                          SkipFlags::None, errorMessage);
+  if (interface == nullptr)
+    return false;
+
+  // Write to a temporary file first, so that concurrent readers never see a
+  // partially written file.
+  auto compiledPath = getCompiledStubPath(path);
+  int fd;
+  SmallString<128> tempPath;
+  if (auto ec = llvm::sys::fs::createUniqueFile(compiledPath + "-%%%%%%", fd,
+                                                tempPath)) {
+    errorMessage = "could not create file " + compiledPath + ": " +
+                   ec.message();
+    return false;
+  }
+
+  {
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    auto content = StringRef(reinterpret_cast<const char *>(data), size);
+    CompiledStubWriter::write(out, *interface,
+                              InterfaceFileCache::computeHash(content), size);
+    out.close();
+    if (out.has_error()) {
+      out.clear_error();
+      llvm::sys::fs::remove(tempPath);
+      errorMessage = "could not write file " + compiledPath;
+      return false;
+    }
   }
 
+  if (auto ec = llvm::sys::fs::rename(tempPath, compiledPath)) {
+    llvm::sys::fs::remove(tempPath);
+    errorMessage = "could not write file " + compiledPath + ": " +
+                   ec.message();
+    return false;
+  }
+
+  return true;
+}
+
+void LinkerInterfaceFile::setCacheCapacity(unsigned capacity) noexcept {
+  getParsedFileCache().setCapacity(capacity);
+}
+
+unsigned LinkerInterfaceFile::getCacheCapacity() noexcept {
+  return getParsedFileCache().getCapacity();
+}
+
+void LinkerInterfaceFile::clearCache() noexcept {
+  getParsedFileCache().clear();
+}
+
+CacheStatistics LinkerInterfaceFile::getCacheStatistics() noexcept {
+  auto stats = getParsedFileCache().getStatistics();
+  CacheStatistics result;
+  result.hits = stats.hits;
+  result.misses = stats.misses;
+  result.evictions = stats.evictions;
+  result.entries = stats.entries;
+  return result;
+}
+
+void LinkerInterfaceFile::setStatisticsEnabled(bool enabled) noexcept {
+  // Read the environment first, so that it doesn't override the setting.
+  Instrumentation::initialize();
+  Instrumentation::setEnabled(enabled);
+}
+
+bool LinkerInterfaceFile::isStatisticsEnabled() noexcept {
+  Instrumentation::initialize();
+  return Instrumentation::isEnabled();
+}
+
+Statistics LinkerInterfaceFile::getStatistics() noexcept {
+  using Phase = Instrumentation::Phase;
+  using Counter = Instrumentation::Counter;
+  Statistics result;
+  result.copyTime = Instrumentation::getTime(Phase::Copy);
+  result.parseTime = Instrumentation::getTime(Phase::Parse);
+  result.denormalizeTime = Instrumentation::getTime(Phase::Denormalize);
+  result.projectionTime = Instrumentation::getTime(Phase::Projection);
+  result.sortTime = Instrumentation::getTime(Phase::Sort);
+  result.linkerDirectivesTime =
+      Instrumentation::getTime(Phase::LinkerDirectives);
+  result.readBinaryTime = Instrumentation::getTime(Phase::ReadBinary);
+  result.filesCreated = Instrumentation::get(Counter::FilesCreated);
+  result.textFilesRead = Instrumentation::get(Counter::TextFilesRead);
+  result.binaryFilesRead = Instrumentation::get(Counter::BinaryFilesRead);
+  result.bytesRead = Instrumentation::get(Counter::BytesRead);
+  result.symbolsRead = Instrumentation::get(Counter::SymbolsRead);
+  return result;
+}
+
+void LinkerInterfaceFile::resetStatistics() noexcept {
+  Instrumentation::reset();
+}
+
+LinkerInterfaceFile *LinkerInterfaceFile::create(
+    const std::string &path, const uint8_t *data, size_t size,
+    cpu_type_t cpuType, cpu_subtype_t cpuSubType,
+    CpuSubTypeMatching matchingMode, PackedVersion32 minOSVersion,
+    std::string &errorMessage) noexcept {
+  auto flags = ParsingFlags::None;
+  if (matchingMode == CpuSubTypeMatching::Exact)
+    flags |= ParsingFlags::ExactCpuSubType;
+
+  return create(path, data, size, cpuType, cpuSubType, flags, minOSVersion,
+                errorMessage);
+}
+
+/// \brief Select the architecture slice of the file for the cpu type.
+///
+/// \returns Arch::unknown and sets the error message if the file doesn't
+///          have a matching slice.
+static Arch selectArch(const InterfaceFile &interface, const std::string &path,
+                       cpu_type_t cpuType, cpu_subtype_t cpuSubType,
+                       ParsingFlags flags, std::string &errorMessage) {
+  bool enforceCpuSubType =
+      (flags & ParsingFlags::ExactCpuSubType) != ParsingFlags::None;
+  auto arch = getArchForCPU(cpuType, cpuSubType, enforceCpuSubType,
+                            interface.getArchitectures());
+  if (arch != Arch::unknown)
+    return arch;
+
+  arch = getArchType(cpuType, cpuSubType);
+  auto count = interface.getArchitectures().count();
+  if (count > 1)
+    errorMessage = "missing required architecture " + getArchName(arch).str() +
+                   " in file " + path + " (" + std::to_string(count) +
+                   " slices)";
+  else
+    errorMessage = "missing required architecture " + getArchName(arch).str() +
+                   " in file " + path;
+  return Arch::unknown;
+}
+
+LinkerInterfaceFile *
+LinkerInterfaceFile::Impl::create(InterfaceFileCache::FilePtr parsed,
+                                  Arch arch, ParsingFlags flags,
+                                  PackedVersion32 minOSVersion) {
+  const auto *interface = &parsed->getInterfaceFile();
+
   // Remove the patch level.
   minOSVersion =
       PackedVersion32(minOSVersion.getMajor(), minOSVersion.getMinor(), 0);
 
   auto file = new LinkerInterfaceFile;
-  if (file == nullptr) {
-    errorMessage = "could not allocate memory";
+  if (file == nullptr)
     return nullptr;
-  }
 
   file->_pImpl->_platform = interface->getPlatform();
   file->_pImpl->_installName = interface->getInstallName();
@@ -302,87 +939,447 @@ LinkerInterfaceFile *LinkerInterfaceFile::create(
   else
     file->_pImpl->_fileType = FileType::Unsupported;
 
-  auto platform = interface->getPlatform();
-  std::vector<Symbol> exports;
-  for (auto &it : interface->exports()) {
-    auto &symbol = it.second;
+  file->_pImpl->_hasWeakDefExports = parsed->getWeakDefinedArchs().has(arch);
+  file->_pImpl->_parsed = parsed;
+  file->_pImpl->_interface = interface;
+  file->_pImpl->_arch = arch;
+
+  // Only the $ld$ directives are applied eagerly, because they can change the
+  // install name, compatibility version, and the list of exported symbols.
+  {
+    Instrumentation::Timer timer(Instrumentation::Phase::LinkerDirectives);
+    const auto &directives = parsed->getLinkerDirectives();
+    for (const auto &directive : directives.lookup(minOSVersion))
+      if (directive.archs.has(arch))
+        file->_pImpl->applyLinkerDirective(directive);
+  }
+
+  // The parsed file might have been read with the sections by an earlier
+  // call, but the sections are still omitted.
+  if ((flags & ParsingFlags::SkipUndefineds) != ParsingFlags::None) {
+    file->_pImpl->_skipUndefineds = true;
+    file->_pImpl->_undefineds = &file->_pImpl->_noSymbols;
+  }
+
+  if ((flags & ParsingFlags::SkipAllowableClients) == ParsingFlags::None)
+    for (const auto &client : interface->allowableClients())
+      if (client.hasArchitecture(arch))
+        file->_pImpl->_allowableClients.emplace_back(client.getInstallName());
+
+  for (const auto &reexport : interface->reexportedLibraries())
+    if (reexport.hasArchitecture(arch))
+      file->_pImpl->_reexportedLibraries.emplace_back(
+          reexport.getInstallName());
+
+  {
+    Instrumentation::Timer timer(Instrumentation::Phase::Sort);
+    sort(file->_pImpl->_allowableClients);
+    sort(file->_pImpl->_reexportedLibraries);
+    auto &hiddenNames = file->_pImpl->_hiddenNames;
+    sort(hiddenNames);
+    hiddenNames.erase(std::unique(hiddenNames.begin(), hiddenNames.end()),
+                      hiddenNames.end());
+  }
+
+  file->_pImpl->_ignoreExports.reserve(file->_pImpl->_hiddenNames.size());
+  for (auto name : file->_pImpl->_hiddenNames)
+    file->_pImpl->_ignoreExports.emplace_back(name);
+
+  Instrumentation::add(Instrumentation::Counter::FilesCreated, 1);
+  return file;
+}
+
+LinkerInterfaceFile *LinkerInterfaceFile::create(
+    const std::string &path, const uint8_t *data, size_t size,
+    cpu_type_t cpuType, cpu_subtype_t cpuSubType, ParsingFlags flags,
+    PackedVersion32 minOSVersion, std::string &errorMessage) noexcept {
+  if (path.empty() || data == nullptr || size < 8) {
+    errorMessage = "invalid argument";
+    return nullptr;
+  }
+
+  Instrumentation::Trace trace(path);
+  auto parsed = readTextBasedStubFile(path, data, size, flags, errorMessage);
+  if (parsed == nullptr)
+    return nullptr;
+
+  auto arch = selectArch(parsed->getInterfaceFile(), path, cpuType, cpuSubType,
+                         flags, errorMessage);
+  if (arch == Arch::unknown)
+    return nullptr;
+
+  auto *file = Impl::create(std::move(parsed), arch, flags, minOSVersion);
+  if (file == nullptr)
+    errorMessage = "could not allocate memory";
+  return file;
+}
+
+std::vector<BatchResult> LinkerInterfaceFile::createSlices(
+    const std::string &path, const uint8_t *data, size_t size,
+    const std::vector<CpuType> &cpuTypes, ParsingFlags flags,
+    PackedVersion32 minOSVersion) noexcept {
+  std::vector<BatchResult> results(cpuTypes.size());
+  auto fail = [&results](const std::string &errorMessage) {
+    for (auto &result : results)
+      result.errorMessage = errorMessage;
+    return std::move(results);
+  };
+
+  if (path.empty() || data == nullptr || size < 8)
+    return fail("invalid argument");
+
+  Instrumentation::Trace trace(path);
+  std::string errorMessage;
+  auto parsed = readTextBasedStubFile(path, data, size, flags, errorMessage);
+  if (parsed == nullptr)
+    return fail(errorMessage);
+
+  std::vector<Arch> archs;
+  archs.reserve(cpuTypes.size());
+  ArchitectureSet selected;
+  for (unsigned i = 0, e = cpuTypes.size(); i != e; ++i) {
+    auto arch = selectArch(parsed->getInterfaceFile(), path, cpuTypes[i].type,
+                           cpuTypes[i].subType, flags,
+                           results[i].errorMessage);
+    archs.emplace_back(arch);
+    if (arch != Arch::unknown)
+      selected.set(arch);
+  }
 
-    if (!symbol.hasArch(arch))
+  // Project all slices in one pass once the first one is needed.
+  parsed->expectSlices(selected);
+  for (unsigned i = 0, e = cpuTypes.size(); i != e; ++i) {
+    if (archs[i] == Arch::unknown)
       continue;
+    results[i].file = Impl::create(parsed, archs[i], flags, minOSVersion);
+    if (results[i].file == nullptr)
+      results[i].errorMessage = "could not allocate memory";
+  }
+  return results;
+}
 
-    if (symbol.isSymbol()) {
-      exports.emplace_back(symbol.getName(), symbol.getFlags());
-    } else if (symbol.isObjCClass()) {
-      if (platform == Platform::OSX && arch == Arch::i386) {
-        exports.emplace_back(".objc_class_name" + symbol.getName(),
-                             symbol.getFlags());
-      } else {
-        exports.emplace_back("_OBJC_CLASS_$" + symbol.getName(),
-                             symbol.getFlags());
-        exports.emplace_back("_OBJC_METACLASS_$" + symbol.getName(),
-                             symbol.getFlags());
-      }
-    } else if (symbol.isObjCInstanceVariable()) {
-      exports.emplace_back("_OBJC_IVAR_$" + symbol.getName(),
-                           symbol.getFlags());
+std::vector<BatchResult> LinkerInterfaceFile::createBatch(
+    const std::vector<FileBuffer> &files, cpu_type_t cpuType,
+    cpu_subtype_t cpuSubType, ParsingFlags flags, PackedVersion32 minOSVersion,
+    unsigned threadCount) noexcept {
+  std::vector<BatchResult> results(files.size());
+  parallelFor(files.size(), threadCount, [&](size_t i) {
+    const auto &buffer = files[i];
+    auto &result = results[i];
+    result.file = create(buffer.path, buffer.data, buffer.size, cpuType,
+                         cpuSubType, flags, minOSVersion, result.errorMessage);
+  });
+  return results;
+}
+
+class PrefetchHandle::Impl {
+public:
+  PrefetchProgress _progress;
+  std::mutex _progressMutex;
+  std::atomic<bool> _isCancelled{false};
+  std::atomic<bool> _isDone{false};
+  std::atomic<size_t> _completed{0};
+  std::atomic<size_t> _failed{0};
+  std::atomic<size_t> _total{0};
+
+  std::mutex _threadMutex;
+  std::thread _thread;
+
+  bool start(std::vector<std::string> paths, std::string directory,
+             ParsingFlags flags, PrefetchProgress progress,
+             unsigned threadCount);
+  void run(std::vector<std::string> paths, const std::string &directory,
+           ParsingFlags flags, unsigned threadCount);
+  bool prefetch(const std::vector<std::string> &aliases, ParsingFlags flags);
+};
+
+PrefetchHandle::PrefetchHandle() noexcept : _pImpl{new PrefetchHandle::Impl} {}
+
+PrefetchHandle::~PrefetchHandle() noexcept {
+  cancel();
+  wait();
+}
+
+void PrefetchHandle::cancel() noexcept { _pImpl->_isCancelled = true; }
+
+void PrefetchHandle::wait() noexcept {
+  std::lock_guard<std::mutex> lock(_pImpl->_threadMutex);
+  if (_pImpl->_thread.joinable())
+    _pImpl->_thread.join();
+}
+
+bool PrefetchHandle::isDone() const noexcept { return _pImpl->_isDone; }
+
+size_t PrefetchHandle::getCompletedCount() const noexcept {
+  return _pImpl->_completed;
+}
+
+size_t PrefetchHandle::getFailedCount() const noexcept {
+  return _pImpl->_failed;
+}
+
+size_t PrefetchHandle::getTotalCount() const noexcept { return _pImpl->_total; }
+
+/// \brief Find the files with a supported extension in the directory and its
+/// subdirectories.
+static void findTextBasedStubFiles(const std::string &directory,
+                                   const std::atomic<bool> &isCancelled,
+                                   std::vector<std::string> &paths) {
+  // Stop descending at some point, in case the symlinks form a cycle.
+  static const int maxDepth = 32;
+  const auto extensions = LinkerInterfaceFile::getSupportedFileExtensions();
+  std::error_code ec;
+  std::string failedPath;
+  for (llvm::sys::fs::recursive_directory_iterator it(directory, ec), end;
+       it != end && !isCancelled; it.increment(ec)) {
+    // Skip an entry that can't be read, such as a directory without
+    // permission, and keep walking the rest of the tree. Give up if the walk
+    // doesn't make progress past the entry.
+    if (ec) {
+      if (it->path() == failedPath)
+        break;
+      failedPath = it->path();
+      ec.clear();
+      it.no_push();
+      continue;
     }
 
-    if (symbol.isWeakDefined())
-      file->_pImpl->_hasWeakDefExports = true;
+    if (it.level() >= maxDepth)
+      it.no_push();
+
+    auto extension = llvm::sys::path::extension(it->path());
+    if (std::find(extensions.begin(), extensions.end(), extension) ==
+        extensions.end())
+      continue;
+
+    if (llvm::sys::fs::is_regular_file(it->path()))
+      paths.emplace_back(it->path());
   }
+}
 
-  for (auto &it : interface->undefineds()) {
-    auto &symbol = it.second;
+/// \brief Read and parse the file once and add it to the cache under every
+/// path that refers to it.
+bool PrefetchHandle::Impl::prefetch(const std::vector<std::string> &aliases,
+                                    ParsingFlags flags) {
+  const auto &path = aliases.front();
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(
+      path, /*FileSize=*/-1, /*RequiresNullTerminator=*/true);
+  if (!bufferOrErr)
+    return false;
 
-    if (!symbol.hasArch(arch))
-      continue;
+  const auto &buffer = bufferOrErr.get();
+  const auto *data =
+      reinterpret_cast<const uint8_t *>(buffer->getBufferStart());
+  auto size = buffer->getBufferSize();
+  if (size < 8 || !LinkerInterfaceFile::isSupported(path, data, size))
+    return false;
 
-    if (symbol.isSymbol()) {
-      file->_pImpl->_undefineds.emplace_back(symbol.getName(),
-                                             symbol.getFlags());
-    } else if (symbol.isObjCClass()) {
-      if (platform == Platform::OSX && arch == Arch::i386) {
-        file->_pImpl->_undefineds.emplace_back(
-            ".objc_class_name" + symbol.getName(), symbol.getFlags());
-      } else {
-        file->_pImpl->_undefineds.emplace_back(
-            "_OBJC_CLASS_$" + symbol.getName(), symbol.getFlags());
-        file->_pImpl->_undefineds.emplace_back(
-            "_OBJC_METACLASS_$" + symbol.getName(), symbol.getFlags());
-      }
-    } else if (symbol.isObjCInstanceVariable()) {
-      file->_pImpl->_undefineds.emplace_back("_OBJC_IVAR_$" + symbol.getName(),
-                                             symbol.getFlags());
+  // The buffer is always null-terminated.
+  std::string errorMessage;
+  auto parsed = readTextBasedStubFile(
+      path, data, size, flags | ParsingFlags::NullTerminatedBuffer,
+      errorMessage);
+  if (parsed == nullptr)
+    return false;
+
+  // The aliases share the entry.
+  auto &cache = getParsedFileCache();
+  for (unsigned i = 1, e = aliases.size(); i != e; ++i)
+    cache.insertAlias(aliases[i], path);
+  return true;
+}
+
+void PrefetchHandle::Impl::run(std::vector<std::string> paths,
+                               const std::string &directory,
+                               ParsingFlags flags, unsigned threadCount) {
+  // There is nothing to keep the parsed files alive without the cache.
+  if (getParsedFileCache().isEnabled()) {
+    if (!directory.empty())
+      findTextBasedStubFiles(directory, _isCancelled, paths);
+
+    // Group the paths by the file they refer to.
+    std::vector<std::vector<std::string>> files;
+    llvm::StringMap<size_t> fileIndex;
+    for (auto &path : paths) {
+      SmallString<128> realPath;
+      if (llvm::sys::fs::real_path(path, realPath))
+        realPath = path;
+      auto result =
+          fileIndex.insert(std::make_pair(realPath.str(), files.size()));
+      if (result.second)
+        files.emplace_back();
+      files[result.first->second].emplace_back(std::move(path));
     }
+
+    _total = paths.size();
+    parallelFor(files.size(), threadCount, [&](size_t i) {
+      if (_isCancelled)
+        return;
+
+      if (!prefetch(files[i], flags))
+        _failed += files[i].size();
+      auto completed = _completed += files[i].size();
+      if (_progress) {
+        std::lock_guard<std::mutex> lock(_progressMutex);
+        _progress(completed, _total);
+      }
+    });
   }
 
-  for (const auto &client : interface->allowableClients())
-    if (client.hasArchitecture(arch))
-      file->_pImpl->_allowableClients.emplace_back(client.getInstallName());
+  _isDone = true;
+}
 
-  for (const auto &reexport : interface->reexportedLibraries())
-    if (reexport.hasArchitecture(arch))
-      file->_pImpl->_reexportedLibraries.emplace_back(
-          reexport.getInstallName());
+/// \brief Start the background thread. Returns false if the thread couldn't
+/// be started, because the process ran out of threads.
+bool PrefetchHandle::Impl::start(std::vector<std::string> paths,
+                                 std::string directory, ParsingFlags flags,
+                                 PrefetchProgress progress,
+                                 unsigned threadCount) {
+  _progress = std::move(progress);
+  try {
+    _thread = std::thread(&Impl::run, this, std::move(paths),
+                          std::move(directory), flags, threadCount);
+  } catch (const std::system_error &) {
+    return false;
+  }
+  return true;
+}
 
-  sort(file->_pImpl->_allowableClients);
-  sort(file->_pImpl->_reexportedLibraries);
-  sort(exports, [](const Symbol &lhs, const Symbol &rhs) {
-    return lhs.getName() < rhs.getName();
-  });
-  sort(file->_pImpl->_undefineds, [](const Symbol &lhs, const Symbol &rhs) {
-    return lhs.getName() < rhs.getName();
-  });
+PrefetchHandle *LinkerInterfaceFile::prefetch(
+    const std::vector<std::string> &paths, ParsingFlags flags,
+    PrefetchProgress progress, unsigned threadCount) noexcept {
+  auto handle = new PrefetchHandle;
+  if (!handle->_pImpl->start(paths, std::string(), flags, std::move(progress),
+                             threadCount)) {
+    delete handle;
+    return nullptr;
+  }
+  return handle;
+}
 
-  for (auto &symbol : exports)
-    file->_pImpl->addSymbol(std::move(symbol), minOSVersion);
+PrefetchHandle *LinkerInterfaceFile::prefetchDirectory(
+    const std::string &directory, ParsingFlags flags,
+    PrefetchProgress progress, unsigned threadCount) noexcept {
+  if (directory.empty())
+    return nullptr;
 
-  sort(file->_pImpl->_ignoreExports);
-  auto last = std::unique(file->_pImpl->_ignoreExports.begin(),
-                          file->_pImpl->_ignoreExports.end());
-  file->_pImpl->_ignoreExports.erase(last, file->_pImpl->_ignoreExports.end());
+  auto handle = new PrefetchHandle;
+  if (!handle->_pImpl->start(std::vector<std::string>(), directory, flags,
+                             std::move(progress), threadCount)) {
+    delete handle;
+    return nullptr;
+  }
+  return handle;
+}
 
-  return file;
+class ReexportSession::Impl {
+public:
+  Impl(cpu_type_t cpuType, cpu_subtype_t cpuSubType, ParsingFlags flags,
+       PackedVersion32 minOSVersion, LibraryLocator locator)
+      : _cpuType(cpuType), _cpuSubType(cpuSubType), _flags(flags),
+        _locator(std::move(locator)),
+        // Remove the patch level, like LinkerInterfaceFile::create.
+        _resolver([this](StringRef installName) { return load(installName); },
+                  PackedVersion32(minOSVersion.getMajor(),
+                                  minOSVersion.getMinor(), 0)) {}
+
+  std::unique_ptr<InterfaceFile> load(StringRef installName);
+  bool findExport(StringRef installName, StringRef name, SymbolFlags &flags,
+                  std::string &libraryInstallName);
+
+  cpu_type_t _cpuType;
+  cpu_subtype_t _cpuSubType;
+  ParsingFlags _flags;
+  LibraryLocator _locator;
+  ReexportResolver _resolver;
+};
+
+std::unique_ptr<InterfaceFile>
+ReexportSession::Impl::load(StringRef installName) {
+  auto path = _locator ? _locator(installName.str()) : std::string();
+  if (path.empty())
+    return nullptr;
+
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(path);
+  if (!bufferOrErr)
+    return nullptr;
+
+  // Only the exports and the re-exports are needed. The file doesn't
+  // reference the buffer, because all names are interned.
+  const auto &registry = getRegistry();
+  auto file = registry.readFile(bufferOrErr.get()->getMemBufferRef(),
+                                ReadFlags::All,
+                                getSkipFlags(_flags) | SkipFlags::Undefineds |
+                                    SkipFlags::AllowableClients);
+  if (file == nullptr || file->getErrorCode() ||
+      !isa<InterfaceFile>(file.get()))
+    return nullptr;
+
+  return std::unique_ptr<InterfaceFile>(cast<InterfaceFile>(file.release()));
+}
+
+bool ReexportSession::Impl::findExport(StringRef installName, StringRef name,
+                                       SymbolFlags &flags,
+                                       std::string &libraryInstallName) {
+  auto *file = _resolver.getFile(installName);
+  if (file == nullptr)
+    return false;
+
+  // Loads the re-export graph on first use only.
+  _resolver.resolve(*file);
+
+  bool enforceCpuSubType =
+      (_flags & ParsingFlags::ExactCpuSubType) != ParsingFlags::None;
+  auto arch = getArchForCPU(_cpuType, _cpuSubType, enforceCpuSubType,
+                            file->getArchitectures());
+  if (arch == Arch::unknown)
+    return false;
+
+  const auto *match = _resolver.getExports(*file, arch).find(name);
+  if (match == nullptr)
+    return false;
+
+  flags = match->flags;
+  libraryInstallName = match->installName;
+  return true;
+}
+
+ReexportSession::ReexportSession(cpu_type_t cpuType, cpu_subtype_t cpuSubType,
+                                 ParsingFlags flags,
+                                 PackedVersion32 minOSVersion,
+                                 LibraryLocator locator) noexcept
+    : _pImpl{new ReexportSession::Impl(cpuType, cpuSubType, flags,
+                                       minOSVersion, std::move(locator))} {}
+
+ReexportSession::~ReexportSession() noexcept = default;
+
+bool ReexportSession::findExport(const std::string &installName,
+                                 const std::string &name, SymbolFlags &flags,
+                                 std::string &libraryInstallName) noexcept {
+  return _pImpl->findExport(installName, name, flags, libraryInstallName);
+}
+
+std::vector<std::string> ReexportSession::getMissingLibraries() const
+    noexcept {
+  std::vector<std::string> result;
+  for (auto installName : _pImpl->_resolver.getMissingLibraries())
+    result.emplace_back(installName);
+  return result;
+}
+
+std::vector<std::pair<std::string, std::string>>
+ReexportSession::getReexportCycles() const noexcept {
+  std::vector<std::pair<std::string, std::string>> result;
+  for (const auto &cycle : _pImpl->_resolver.getCycles())
+    result.emplace_back(cycle.first, cycle.second);
+  return result;
+}
+
+ReexportSession *LinkerInterfaceFile::createReexportSession(
+    cpu_type_t cpuType, cpu_subtype_t cpuSubType, ParsingFlags flags,
+    PackedVersion32 minOSVersion, LibraryLocator locator) noexcept {
+  return new ReexportSession(cpuType, cpuSubType, flags, minOSVersion,
+                             std::move(locator));
 }
 
 FileType LinkerInterfaceFile::getFileType() const noexcept {
@@ -441,6 +1438,10 @@ const std::string &LinkerInterfaceFile::getParentFrameworkName() const noexcept
   return _pImpl->_parentFrameworkName;
 }
 
+std::string LinkerInterfaceFile::getInterfaceFingerprint() const noexcept {
+  return _pImpl->getFingerprint();
+}
+
 const std::vector<std::string> &LinkerInterfaceFile::allowableClients() const
     noexcept {
   return _pImpl->_allowableClients;
@@ -456,12 +1457,68 @@ const std::vector<std::string> &LinkerInterfaceFile::ignoreExports() const
   return _pImpl->_ignoreExports;
 }
 
+std::vector<std::string> LinkerInterfaceFile::takeAllowableClients() noexcept {
+  return std::move(_pImpl->_allowableClients);
+}
+
+std::vector<std::string>
+LinkerInterfaceFile::takeReexportedLibraries() noexcept {
+  return std::move(_pImpl->_reexportedLibraries);
+}
+
+std::vector<std::string> LinkerInterfaceFile::takeIgnoreExports() noexcept {
+  return std::move(_pImpl->_ignoreExports);
+}
+
+bool LinkerInterfaceFile::containsExport(const std::string &name) const
+    noexcept {
+  SymbolFlags flags;
+  return _pImpl->findExport(name, flags);
+}
+
+bool LinkerInterfaceFile::mayExport(const char *name, size_t length) const
+    noexcept {
+  return _pImpl->mayExport(StringRef(name, length));
+}
+
+bool LinkerInterfaceFile::mayExport(const std::string &name) const noexcept {
+  return _pImpl->mayExport(name);
+}
+
+bool LinkerInterfaceFile::findExport(const std::string &name,
+                                     SymbolFlags &flags) const noexcept {
+  return _pImpl->findExport(name, flags);
+}
+
 const std::vector<Symbol> &LinkerInterfaceFile::exports() const noexcept {
-  return _pImpl->_exports;
+  return _pImpl->getExports();
+}
+
+void LinkerInterfaceFile::releaseParsedData() noexcept {
+  _pImpl->releaseParsedFile();
 }
 
 const std::vector<Symbol> &LinkerInterfaceFile::undefineds() const noexcept {
-  return _pImpl->_undefineds;
+  return _pImpl->getUndefineds();
+}
+
+bool LinkerInterfaceFile::takeExports(std::vector<Symbol> &exports) noexcept {
+  return _pImpl->takeExports(exports);
+}
+
+bool LinkerInterfaceFile::takeUndefineds(
+    std::vector<Symbol> &undefineds) noexcept {
+  return _pImpl->takeUndefineds(undefineds);
+}
+
+void LinkerInterfaceFile::visitExports(const SymbolVisitor &visitor) const
+    noexcept {
+  _pImpl->visitExports(visitor);
+}
+
+void LinkerInterfaceFile::visitUndefineds(const SymbolVisitor &visitor) const
+    noexcept {
+  _pImpl->visitUndefineds(visitor);
 }
 
 TAPI_NAMESPACE_V1_END
@@ -0,0 +1,448 @@
+//===- tapi-benchmark/CorpusGenerator.cpp - Synthetic Corpus ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the synthetic corpus generator.
+///
+//===----------------------------------------------------------------------===//
+
+#include "CorpusGenerator.h"
+#include "tapi/Core/Registry.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/BinaryFormat/MachO.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+namespace {
+
+/// \brief A small deterministic pseudo-random number generator (splitmix64).
+class Random {
+public:
+  Random(uint64_t seed) : _state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  unsigned next(unsigned bound) { return next() % bound; }
+
+private:
+  uint64_t _state;
+};
+
+} // end anonymous namespace.
+
+static std::string generateName(Random &random, size_t index) {
+  static const char *const prefixes[] = {"NS", "CF", "UI", "dispatch_",
+                                         "objc_", "xpc_", "os_", "CG"};
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyz"
+                                "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+  std::string name = prefixes[random.next(array_lengthof(prefixes))];
+  for (unsigned i = 0, e = 8 + random.next(24); i != e; ++i)
+    name += letters[random.next(sizeof(letters) - 1)];
+
+  // The index keeps the names unique.
+  name += std::to_string(index);
+  return name;
+}
+
+/// \brief Return up to count distinct non-empty subsets of the architectures,
+/// starting with the full set.
+static std::vector<ArchitectureSet> getArchSets(ArchitectureSet archs,
+                                                unsigned count) {
+  std::vector<Arch> list(archs.begin(), archs.end());
+  std::vector<ArchitectureSet> sets;
+  uint32_t mask = (1U << list.size()) - 1;
+  for (; mask != 0 && sets.size() < count; --mask) {
+    ArchitectureSet set;
+    for (unsigned i = 0; i < list.size(); ++i)
+      if (mask & (1U << i))
+        set.set(list[i]);
+    sets.emplace_back(set);
+  }
+  return sets;
+}
+
+std::unique_ptr<InterfaceFile>
+generateInterfaceFile(const CorpusOptions &options) {
+  Random random(options.seed);
+  std::unique_ptr<InterfaceFile> file(new InterfaceFile);
+  file->setPath("Bench.tbd");
+  file->setFileType(FileType::TBD_V2);
+  file->setPlatform(Platform::OSX);
+  file->setArchitectures(options.archs);
+  file->setInstallName(
+      "/System/Library/Frameworks/Bench.framework/Versions/A/Bench");
+  file->setCurrentVersion(PackedVersion(1, 2, 3));
+  file->setCompatibilityVersion(PackedVersion(1, 0, 0));
+  file->setObjCConstraint(ObjCConstraint::Retain_Release);
+  file->setTwoLevelNamespace(options.numUndefineds == 0);
+  file->setApplicationExtensionSafe();
+
+  for (auto arch : options.archs) {
+    uint8_t uuid[16];
+    for (auto &byte : uuid)
+      byte = static_cast<uint8_t>(random.next());
+    file->addUUID(uuid, arch);
+  }
+
+  auto archSets = getArchSets(options.archs, std::max(options.numArchSets, 1U));
+  std::vector<std::string> symbols;
+  for (size_t i = 0; i < options.numSymbols; ++i) {
+    auto archs = archSets[i % archSets.size()];
+    auto name = "_" + generateName(random, i);
+    if (options.quotedNamePercent != 0 &&
+        random.next(100) < options.quotedNamePercent)
+      name += "$'quoted:";
+    auto kind = random.next(100);
+    if (kind < 70) {
+      auto flags = SymbolFlags::None;
+      if (kind < 4)
+        flags = SymbolFlags::WeakDefined;
+      else if (kind < 6)
+        flags = SymbolFlags::ThreadLocalValue;
+      symbols.emplace_back(name);
+      file->addExportedSymbol(name, SymbolType::Symbol, flags, archs);
+    } else if (kind < 85) {
+      file->addExportedSymbol(name, SymbolType::ObjCClass, SymbolFlags::None,
+                              archs);
+    } else {
+      file->addExportedSymbol(name + ".ivar", SymbolType::ObjCInstanceVariable,
+                              SymbolFlags::None, archs);
+    }
+  }
+
+  for (size_t i = 0; i < options.numLinkerDirectives; ++i) {
+    auto version = "$os10." + std::to_string(4 + random.next(11)) + "$";
+    std::string name;
+    if (i % 2 == 0 && !symbols.empty())
+      name = "$ld$hide" + version + symbols[random.next(symbols.size())];
+    else
+      name = "$ld$add" + version + "_added" + std::to_string(i);
+    file->addExportedSymbol(name, SymbolType::Symbol, SymbolFlags::None,
+                            options.archs);
+  }
+
+  for (size_t i = 0; i < options.numUndefineds; ++i)
+    file->addUndefinedSymbol("_" + generateName(random, i), SymbolType::Symbol,
+                             SymbolFlags::None, options.archs);
+
+  file->finalize();
+  return file;
+}
+
+std::string generateTextBasedStub(InterfaceFile &stub, FileType type) {
+  // The writers are selected by file type and path.
+  auto fileType = stub.getFileType();
+  auto path = stub.getPath();
+  stub.setFileType(type);
+  if (!StringRef(path).endswith(".tbd"))
+    stub.setPath(path + ".tbd");
+
+  Registry registry;
+  registry.addYAMLWriters();
+  std::string content;
+  raw_string_ostream os(content);
+  registry.writeFile(os, &stub);
+  os.flush();
+
+  stub.setFileType(fileType);
+  stub.setPath(path);
+  return content;
+}
+
+namespace {
+
+/// \brief Builds the export trie of a MachO slice.
+class ExportTrie {
+public:
+  struct Export {
+    std::string name;
+    uint64_t flags;
+    uint64_t address;
+  };
+
+  /// \brief Build the trie. The exports have to be sorted by name and unique.
+  ExportTrie(const std::vector<Export> &exports) : _exports(exports) {
+    _nodes.emplace_back();
+    build(0, 0, exports.size(), 0);
+  }
+
+  /// \brief Encode the trie in the dyld export trie format.
+  std::string encode();
+
+private:
+  struct Node {
+    bool isTerminal = false;
+    uint64_t flags = 0;
+    uint64_t address = 0;
+    std::vector<std::pair<std::string, unsigned>> children;
+    uint64_t offset = 0;
+  };
+
+  void build(unsigned node, size_t begin, size_t end, size_t prefix);
+  size_t getSize(const Node &node) const;
+
+  const std::vector<Export> &_exports;
+  std::vector<Node> _nodes;
+};
+
+} // end anonymous namespace.
+
+void ExportTrie::build(unsigned node, size_t begin, size_t end,
+                       size_t prefix) {
+  // The export that ends at this node sorts first.
+  if (begin != end && _exports[begin].name.size() == prefix) {
+    _nodes[node].isTerminal = true;
+    _nodes[node].flags = _exports[begin].flags;
+    _nodes[node].address = _exports[begin].address;
+    ++begin;
+  }
+
+  while (begin != end) {
+    // Group the exports by the next character and share their common prefix.
+    auto c = _exports[begin].name[prefix];
+    auto last = begin + 1;
+    while (last != end && _exports[last].name[prefix] == c)
+      ++last;
+
+    const auto &first = _exports[begin].name;
+    const auto &back = _exports[last - 1].name;
+    auto common = prefix + 1;
+    while (common < first.size() && common < back.size() &&
+           first[common] == back[common])
+      ++common;
+
+    unsigned child = _nodes.size();
+    _nodes.emplace_back();
+    _nodes[node].children.emplace_back(first.substr(prefix, common - prefix),
+                                       child);
+    build(child, begin, last, common);
+    begin = last;
+  }
+}
+
+size_t ExportTrie::getSize(const Node &node) const {
+  size_t size = 0;
+  if (node.isTerminal) {
+    auto info = getULEB128Size(node.flags) + getULEB128Size(node.address);
+    size += getULEB128Size(info) + info;
+  } else
+    size += 1;
+
+  size += 1;
+  for (const auto &child : node.children)
+    size += child.first.size() + 1 +
+            getULEB128Size(_nodes[child.second].offset);
+  return size;
+}
+
+std::string ExportTrie::encode() {
+  // The offsets are ULEB128 encoded, so iterate until the layout is stable.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    uint64_t offset = 0;
+    for (auto &node : _nodes) {
+      if (node.offset != offset) {
+        node.offset = offset;
+        changed = true;
+      }
+      offset += getSize(node);
+    }
+  }
+
+  std::string content;
+  raw_string_ostream os(content);
+  for (const auto &node : _nodes) {
+    if (node.isTerminal) {
+      encodeULEB128(getULEB128Size(node.flags) + getULEB128Size(node.address),
+                    os);
+      encodeULEB128(node.flags, os);
+      encodeULEB128(node.address, os);
+    } else
+      os << '\0';
+
+    os << static_cast<char>(node.children.size());
+    for (const auto &child : node.children) {
+      os << child.first << '\0';
+      encodeULEB128(_nodes[child.second].offset, os);
+    }
+  }
+  os.flush();
+  return content;
+}
+
+static void write32(std::string &buffer, uint32_t value) {
+  char bytes[4];
+  support::endian::write32le(bytes, value);
+  buffer.append(bytes, sizeof(bytes));
+}
+
+static void pad(std::string &buffer, size_t alignment) {
+  buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+static std::string generateSlice(const InterfaceFile &file, Arch arch,
+                                 uint32_t cpuType, uint32_t cpuSubType) {
+  std::vector<ExportTrie::Export> exports;
+  uint64_t address = 0x1000;
+  for (const auto &symbol : file.exports()) {
+    if (!symbol.hasArch(arch))
+      continue;
+
+    uint64_t flags = MachO::EXPORT_SYMBOL_FLAGS_KIND_REGULAR;
+    if (symbol.isWeakDefined())
+      flags |= MachO::EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION;
+    else if (symbol.isThreadLocalValue())
+      flags = MachO::EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL;
+
+    // ObjC classes are exported as a class and a metaclass symbol.
+    switch (symbol.getType()) {
+    case SymbolType::Symbol:
+      exports.push_back({symbol.getName(), flags, address});
+      break;
+    case SymbolType::ObjCClass:
+      exports.push_back(
+          {("_OBJC_CLASS_$" + symbol.getName()).str(), flags, address});
+      exports.push_back(
+          {("_OBJC_METACLASS_$" + symbol.getName()).str(), flags, address});
+      break;
+    case SymbolType::ObjCInstanceVariable:
+      exports.push_back(
+          {("_OBJC_IVAR_$" + symbol.getName()).str(), flags, address});
+      break;
+    }
+    address += 0x10;
+  }
+  std::sort(exports.begin(), exports.end(),
+            [](const ExportTrie::Export &lhs, const ExportTrie::Export &rhs) {
+              return lhs.name < rhs.name;
+            });
+  auto trie = ExportTrie(exports).encode();
+
+  const auto &installName = file.getInstallName();
+  uint32_t idSize = (sizeof(MachO::dylib_command) + installName.size() + 8) &
+                    ~7U;
+  uint32_t commandsSize = idSize + sizeof(MachO::uuid_command) +
+                          sizeof(MachO::version_min_command) +
+                          sizeof(MachO::dyld_info_command);
+  uint32_t trieOffset = (sizeof(MachO::mach_header_64) + commandsSize + 7) &
+                        ~7U;
+
+  std::string buffer;
+  write32(buffer, MachO::MH_MAGIC_64);
+  write32(buffer, cpuType);
+  write32(buffer, cpuSubType);
+  write32(buffer, MachO::MH_DYLIB);
+  write32(buffer, 4);
+  write32(buffer, commandsSize);
+  write32(buffer, MachO::MH_NOUNDEFS | MachO::MH_DYLDLINK |
+                      MachO::MH_TWOLEVEL | MachO::MH_APP_EXTENSION_SAFE);
+  write32(buffer, 0);
+
+  write32(buffer, MachO::LC_ID_DYLIB);
+  write32(buffer, idSize);
+  write32(buffer, sizeof(MachO::dylib_command));
+  write32(buffer, 0);
+  write32(buffer, file.getCurrentVersion()._version);
+  write32(buffer, file.getCompatibilityVersion()._version);
+  buffer += installName;
+  buffer.resize(buffer.size() + idSize - sizeof(MachO::dylib_command) -
+                    installName.size(),
+                '\0');
+
+  write32(buffer, MachO::LC_UUID);
+  write32(buffer, sizeof(MachO::uuid_command));
+  UUID uuid;
+  for (const auto &entry : file.uuids())
+    if (entry.first == arch)
+      uuid = entry.second;
+  buffer.append(reinterpret_cast<const char *>(uuid.bytes()), UUID::size);
+
+  write32(buffer, MachO::LC_VERSION_MIN_MACOSX);
+  write32(buffer, sizeof(MachO::version_min_command));
+  write32(buffer, PackedVersion(10, 12, 0)._version);
+  write32(buffer, PackedVersion(10, 13, 0)._version);
+
+  write32(buffer, MachO::LC_DYLD_INFO_ONLY);
+  write32(buffer, sizeof(MachO::dyld_info_command));
+  for (unsigned i = 0; i < 8; ++i)
+    write32(buffer, 0);
+  write32(buffer, trieOffset);
+  write32(buffer, trie.size());
+
+  pad(buffer, 8);
+  buffer += trie;
+  pad(buffer, 8);
+  return buffer;
+}
+
+std::string generateDynamicLibrary(const InterfaceFile &file) {
+  struct SliceInfo {
+    Arch arch;
+    uint32_t cpuType;
+    uint32_t cpuSubType;
+  };
+  static const SliceInfo sliceInfos[] = {
+      {Arch::x86_64, MachO::CPU_TYPE_X86_64, MachO::CPU_SUBTYPE_X86_64_ALL},
+      {Arch::x86_64h, MachO::CPU_TYPE_X86_64, MachO::CPU_SUBTYPE_X86_64_H},
+      {Arch::arm64, MachO::CPU_TYPE_ARM64, MachO::CPU_SUBTYPE_ARM64_ALL},
+  };
+
+  std::vector<std::pair<const SliceInfo *, std::string>> slices;
+  for (const auto &info : sliceInfos)
+    if (file.getArchitectures().has(info.arch))
+      slices.emplace_back(&info, generateSlice(file, info.arch, info.cpuType,
+                                               info.cpuSubType));
+
+  if (slices.size() == 1)
+    return std::move(slices.front().second);
+
+  // The universal header is big endian and the slices are page aligned.
+  const unsigned alignment = 12;
+  std::string buffer;
+  auto write32be = [&buffer](uint32_t value) {
+    char bytes[4];
+    support::endian::write32be(bytes, value);
+    buffer.append(bytes, sizeof(bytes));
+  };
+
+  write32be(MachO::FAT_MAGIC);
+  write32be(slices.size());
+  uint32_t offset = sizeof(MachO::fat_header) +
+                    slices.size() * sizeof(MachO::fat_arch);
+  for (const auto &slice : slices) {
+    offset = alignTo(offset, 1U << alignment);
+    write32be(slice.first->cpuType);
+    write32be(slice.first->cpuSubType);
+    write32be(offset);
+    write32be(slice.second.size());
+    write32be(alignment);
+    offset += slice.second.size();
+  }
+
+  for (const auto &slice : slices) {
+    pad(buffer, 1U << alignment);
+    buffer += slice.second;
+  }
+  return buffer;
+}
+
+TAPI_NAMESPACE_INTERNAL_END
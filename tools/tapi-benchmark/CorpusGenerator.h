@@ -0,0 +1,81 @@
+//===- tapi-benchmark/CorpusGenerator.h - Synthetic Corpus ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Generates synthetic interface files, text-based stubs, and dylibs.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TAPI_BENCHMARK_CORPUS_GENERATOR_H
+#define TAPI_BENCHMARK_CORPUS_GENERATOR_H
+
+#include "tapi/Core/ArchitectureSupport.h"
+#include "tapi/Core/File.h"
+#include "tapi/Core/InterfaceFile.h"
+#include "tapi/Defines.h"
+#include <memory>
+#include <string>
+
+TAPI_NAMESPACE_INTERNAL_BEGIN
+
+/// \brief Describes the content of a synthetic interface file.
+struct CorpusOptions {
+  /// \brief The number of exported symbols, including ObjC classes and ivars.
+  size_t numSymbols = 1000;
+
+  /// \brief The architectures of the library.
+  ArchitectureSet archs = ArchitectureSet(Arch::i386 | Arch::x86_64 |
+                                          Arch::arm64);
+
+  /// \brief The number of distinct architecture sets the symbols are spread
+  /// over. Every set is a non-empty subset of the architectures.
+  unsigned numArchSets = 3;
+
+  /// \brief The number of $ld$hide and $ld$add directives. They are added on
+  /// top of the regular symbols.
+  size_t numLinkerDirectives = 0;
+
+  /// \brief The number of undefined symbols. Undefined symbols are only
+  /// recorded for flat namespace libraries.
+  size_t numUndefineds = 0;
+
+  /// \brief The percentage of exported symbol names that contain characters
+  /// the text-based stub writers have to quote.
+  unsigned quotedNamePercent = 0;
+
+  /// \brief Seed for the pseudo-random name generation.
+  uint64_t seed = 0;
+};
+
+/// \brief Create an interface file with the described content.
+///
+/// The symbol names are pseudo-random but deterministic for a given seed. The
+/// file has a UUID for every architecture.
+std::unique_ptr<InterfaceFile>
+generateInterfaceFile(const CorpusOptions &options);
+
+/// \brief Serialize the interface file as a text-based stub of the given
+/// version (FileType::TBD_V1 or FileType::TBD_V2).
+///
+/// The file type and path of the file are temporarily changed to select the
+/// writer and restored afterwards.
+std::string generateTextBasedStub(InterfaceFile &file, FileType type);
+
+/// \brief Serialize the interface file as a MachO dynamic library.
+///
+/// Every 64-bit architecture of the file becomes a slice with a minimal set of
+/// load commands (LC_ID_DYLIB, LC_UUID, LC_VERSION_MIN_MACOSX, and
+/// LC_DYLD_INFO_ONLY) and an export trie with the symbols of that
+/// architecture. A universal binary is created if there is more than one
+/// slice. 32-bit architectures are skipped.
+std::string generateDynamicLibrary(const InterfaceFile &file);
+
+TAPI_NAMESPACE_INTERNAL_END
+
+#endif // TAPI_BENCHMARK_CORPUS_GENERATOR_H
@@ -0,0 +1,716 @@
+//===- tapi-benchmark/tapi-benchmark.cpp - TAPI Benchmark Tool --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Measures the hot paths of the library on a synthetic corpus.
+///
+/// Every benchmark runs until the minimum time is reached and reports the time
+/// per iteration, the throughput in bytes and symbols, the number of
+/// allocations per iteration, and the peak resident set size of the process.
+/// Every iteration starts a new string pool session, so that it interns its
+/// names like the first file of a process. Before the fingerprint benchmark,
+/// the tool checks that a generated dylib and its text-based stubs have the
+/// same fingerprint, and fails otherwise.
+///
+/// With -scenarios the tool runs pathological inputs instead, which catch
+/// accidentally quadratic behavior. The results can be recorded as a baseline
+/// with -write-baseline and checked against it with -baseline, which fails if
+/// a benchmark allocates more than before. The times depend on the machine, so
+/// a baseline only records them with -baseline-times, and only then fails if a
+/// benchmark got slower than the tolerance. The allocation counts depend on how
+/// the platform lets the tool count them, so a baseline keeps the results of
+/// every counting mode apart and is only compared with results of the same
+/// mode. The allocations through operator new are counted on every platform
+/// and always recorded too, so a baseline without the mode of the platform
+/// is compared with those instead.
+///
+//===----------------------------------------------------------------------===//
+
+#include "CorpusGenerator.h"
+#include "tapi/Core/Registry.h"
+#include "tapi/Core/StringPool.h"
+#include "llvm/BinaryFormat/MachO.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <new>
+#include <sys/resource.h>
+#include <tapi/tapi.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#endif
+
+using namespace llvm;
+using namespace tapi::internal;
+
+static cl::list<unsigned>
+    symbolCounts("symbols", cl::CommaSeparated,
+                 cl::desc("Number of symbols of the generated libraries"),
+                 cl::value_desc("n,..."));
+
+static cl::opt<double> minTime("min-time", cl::init(1.0),
+                               cl::desc("Minimum run time of each benchmark "
+                                        "in seconds"),
+                               cl::value_desc("seconds"));
+
+static cl::opt<std::string> filter("filter",
+                                   cl::desc("Only run the benchmarks whose "
+                                            "name contains the string"),
+                                   cl::value_desc("string"));
+
+static cl::opt<unsigned> seed("seed", cl::init(0),
+                              cl::desc("Seed of the corpus generator"));
+
+static cl::opt<bool> scenarios("scenarios",
+                               cl::desc("Run the pathological scenarios "
+                                        "instead of the microbenchmarks"));
+
+static cl::opt<std::string>
+    baselinePath("baseline",
+                 cl::desc("Fail if the results regressed against the baseline"),
+                 cl::value_desc("file"));
+
+static cl::opt<std::string>
+    writeBaselinePath("write-baseline",
+                      cl::desc("Record the results as the new baseline"),
+                      cl::value_desc("file"));
+
+static cl::opt<bool>
+    baselineTimes("baseline-times",
+                  cl::desc("Record the times in the new baseline, which is "
+                           "then only valid on this machine"));
+
+static cl::opt<double>
+    tolerance("tolerance", cl::init(2.0),
+              cl::desc("Allowed slowdown against the baseline as a factor"),
+              cl::value_desc("factor"));
+
+/// The allocations of the whole process, including the ones that don't go
+/// through operator new, such as those of BumpPtrAllocator and the string pool.
+static std::atomic<uint64_t> numAllocations(0);
+
+/// The allocations through operator new. They can be counted on every
+/// platform, so a baseline can fall back to them when it has no counts of the
+/// counting mode of the platform.
+static std::atomic<uint64_t> numNewAllocations(0);
+
+void *operator new(size_t size) {
+  ++numNewAllocations;
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept {
+  ++numAllocations;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+  ++numAllocations;
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+  ++numAllocations;
+  return __libc_realloc(ptr, size);
+}
+}
+
+static void countAllocations() {}
+
+static uint64_t getAllocationCount() { return numAllocations; }
+
+static const char countingMode[] = "glibc-malloc";
+#elif defined(__APPLE__)
+static void *(*zoneMalloc)(malloc_zone_t *, size_t);
+static void *(*zoneCalloc)(malloc_zone_t *, size_t, size_t);
+static void *(*zoneRealloc)(malloc_zone_t *, void *, size_t);
+
+static void *countingMalloc(malloc_zone_t *zone, size_t size) {
+  ++numAllocations;
+  return zoneMalloc(zone, size);
+}
+
+static void *countingCalloc(malloc_zone_t *zone, size_t count, size_t size) {
+  ++numAllocations;
+  return zoneCalloc(zone, count, size);
+}
+
+static void *countingRealloc(malloc_zone_t *zone, void *ptr, size_t size) {
+  ++numAllocations;
+  return zoneRealloc(zone, ptr, size);
+}
+
+/// \brief Route the allocations of the default zone through the counters.
+static void countAllocations() {
+  auto *zone = malloc_default_zone();
+  auto address = reinterpret_cast<vm_address_t>(zone);
+
+  // The zone is read-only.
+  vm_protect(mach_task_self(), address, sizeof(*zone), false,
+             VM_PROT_READ | VM_PROT_WRITE);
+  zoneMalloc = zone->malloc;
+  zoneCalloc = zone->calloc;
+  zoneRealloc = zone->realloc;
+  zone->malloc = countingMalloc;
+  zone->calloc = countingCalloc;
+  zone->realloc = countingRealloc;
+  vm_protect(mach_task_self(), address, sizeof(*zone), false, VM_PROT_READ);
+}
+
+static uint64_t getAllocationCount() { return numAllocations; }
+
+static const char countingMode[] = "malloc-zone";
+#else
+// Only the allocations through operator new can be counted.
+static void countAllocations() {}
+
+static uint64_t getAllocationCount() { return numNewAllocations; }
+
+static const char countingMode[] = "operator-new";
+#endif
+
+/// \brief Return the peak resident set size of the process in bytes.
+static uint64_t getPeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+/// \brief The measurements of one benchmark.
+struct Result {
+  std::string name;
+  size_t symbols;
+  double microseconds;
+  double allocations;
+  double newAllocations;
+};
+
+static std::vector<Result> results;
+
+/// \brief Run the benchmark, print one line of results, and record them.
+///
+/// \param bytes The number of bytes processed by one iteration.
+/// \param symbols The number of symbols processed by one iteration.
+/// \param body Runs one iteration and returns false on error.
+static bool runBenchmark(StringRef name, size_t bytes, size_t symbols,
+                         std::function<bool()> body) {
+  if (!filter.empty() && name.find(filter) == StringRef::npos)
+    return true;
+
+  // Don't intern into the pool of the generated corpus, which already holds
+  // all names.
+  auto iteration = [&body] {
+    StringPool::startSession();
+    return body();
+  };
+
+  // Warm up once, so that one-time initialization is not measured.
+  if (!iteration()) {
+    errs() << "error: benchmark '" << name << "' failed\n";
+    return false;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  uint64_t iterations = 0;
+  auto allocations = getAllocationCount();
+  auto newAllocations = numNewAllocations.load();
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed;
+  do {
+    if (!iteration()) {
+      errs() << "error: benchmark '" << name << "' failed\n";
+      return false;
+    }
+    ++iterations;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < minTime);
+  allocations = getAllocationCount() - allocations;
+  newAllocations = numNewAllocations.load() - newAllocations;
+
+  auto seconds = elapsed.count() / iterations;
+  auto allocationsPerIteration = static_cast<double>(allocations) / iterations;
+  outs() << format("%-24s %8zu %8llu %12.1f %10.1f %10.3f %12.1f %10.1f\n",
+                   name.str().c_str(), symbols,
+                   static_cast<unsigned long long>(iterations), seconds * 1e6,
+                   bytes / seconds / (1024 * 1024), symbols / seconds / 1e6,
+                   allocationsPerIteration, getPeakRSS() / (1024.0 * 1024.0));
+  results.push_back({name, symbols, seconds * 1e6, allocationsPerIteration,
+                     static_cast<double>(newAllocations) / iterations});
+  return true;
+}
+
+/// \brief An input that stresses one part of the library.
+struct Scenario {
+  const char *name;
+  CorpusOptions options;
+};
+
+static std::vector<Scenario> getScenarios() {
+  std::vector<Scenario> scenarios;
+  auto add = [&](const char *name, size_t numSymbols,
+                 std::function<void(CorpusOptions &)> customize) {
+    CorpusOptions options;
+    options.numSymbols = numSymbols;
+    options.seed = seed;
+    customize(options);
+    scenarios.push_back({name, options});
+  };
+
+  // Hundreds of thousands of symbols with the default architectures.
+  add("large", 500000, [](CorpusOptions &) {});
+
+  // Every subset of all architectures, which gives the writers the most
+  // export sections to group the symbols into.
+  add("arch-sets", 200000, [](CorpusOptions &options) {
+    options.archs = ArchitectureSet(Arch::armv7 | Arch::armv7s |
+                                    Arch::armv7k | Arch::arm64 | Arch::i386 |
+                                    Arch::x86_64 | Arch::x86_64h);
+    options.numArchSets = 127;
+  });
+
+  // Thousands of $ld$hide and $ld$add directives, which are applied every
+  // time a file is created.
+  add("ld-directives", 100000,
+      [](CorpusOptions &options) { options.numLinkerDirectives = 20000; });
+
+  // Names the writers have to quote and the readers have to unquote.
+  add("quoted", 200000,
+      [](CorpusOptions &options) { options.quotedNamePercent = 50; });
+
+  // A flat namespace library whose undefined symbols outnumber the exports.
+  add("flat", 100000,
+      [](CorpusOptions &options) { options.numUndefineds = 200000; });
+
+  return scenarios;
+}
+
+static bool runScenario(const Scenario &scenario) {
+  bool success = true;
+  auto file = generateInterfaceFile(scenario.options);
+  auto v1 = generateTextBasedStub(*file, FileType::TBD_V1);
+  auto v2 = generateTextBasedStub(*file, FileType::TBD_V2);
+  auto dylib = generateDynamicLibrary(*file);
+  auto symbols = file->exports().size() + file->undefineds().size();
+  auto getName = [&scenario](StringRef benchmark) {
+    return (Twine(scenario.name) + "/" + benchmark).str();
+  };
+
+  Registry readers;
+  readers.addYAMLReaders();
+  readers.addBinaryReaders();
+  auto read = [&readers](const std::string &content, StringRef path) {
+    auto file = readers.readFile(MemoryBufferRef(content, path));
+    return file && !file->getErrorCode();
+  };
+  success &= runBenchmark(getName("read-v1"), v1.size(), symbols,
+                          [&] { return read(v1, "Bench.tbd"); });
+  success &= runBenchmark(getName("read-v2"), v2.size(), symbols,
+                          [&] { return read(v2, "Bench.tbd"); });
+  if (!dylib.empty())
+    success &= runBenchmark(getName("read-macho"), dylib.size(), symbols,
+                            [&] { return read(dylib, "Bench"); });
+
+  success &= runBenchmark(getName("create"), v2.size(), symbols, [&] {
+    std::string errorMessage;
+    std::unique_ptr<tapi::LinkerInterfaceFile> linkerFile(
+        tapi::LinkerInterfaceFile::create(
+            "Bench.tbd", reinterpret_cast<const uint8_t *>(v2.data()),
+            v2.size(), MachO::CPU_TYPE_X86_64, MachO::CPU_SUBTYPE_X86_64_ALL,
+            tapi::ParsingFlags::None, tapi::PackedVersion32(10, 9, 0),
+            errorMessage));
+    return linkerFile != nullptr && !linkerFile->exports().empty();
+  });
+
+  Registry writers;
+  writers.addYAMLWriters();
+  success &= runBenchmark(getName("write-v2"), v2.size(), symbols, [&] {
+    raw_null_ostream os;
+    return !writers.writeFile(os, file.get());
+  });
+
+  return success;
+}
+
+/// \brief The results of a baseline, by the way the allocations were counted.
+using Baseline = std::map<std::string, std::vector<Result>>;
+
+static bool readBaseline(StringRef path, Baseline &baseline) {
+  auto bufferOrErr = MemoryBuffer::getFile(path);
+  if (!bufferOrErr) {
+    errs() << "error: cannot read baseline '" << path << "': "
+           << bufferOrErr.getError().message() << "\n";
+    return false;
+  }
+
+  std::vector<Result> *section = nullptr;
+  SmallVector<StringRef, 16> lines;
+  bufferOrErr.get()->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+
+    SmallVector<StringRef, 4> fields;
+    line.split(fields, ' ', -1, false);
+    if (fields[0] == "counting" && fields.size() == 2) {
+      section = &baseline[fields[1]];
+      continue;
+    }
+
+    Result result;
+    result.microseconds = 0;
+    result.newAllocations = 0;
+    unsigned long long symbols;
+    if (section == nullptr || fields.size() < 3 || fields.size() > 4 ||
+        fields[1].getAsInteger(10, symbols) ||
+        fields[2].getAsDouble(result.allocations) ||
+        (fields.size() == 4 && fields[3].getAsDouble(result.microseconds))) {
+      errs() << "error: malformed baseline line '" << line << "'\n";
+      return false;
+    }
+    result.name = fields[0];
+    result.symbols = symbols;
+    section->push_back(result);
+  }
+  return true;
+}
+
+/// \brief Record the results as the baseline of the current counting mode,
+/// and the operator new counts as the baseline of that mode.
+///
+/// The results of the other counting modes are kept, so that one baseline can
+/// serve every platform.
+static bool writeBaseline(StringRef path) {
+  Baseline baseline;
+  if (sys::fs::exists(path) && !readBaseline(path, baseline))
+    return false;
+
+  auto &section = baseline[countingMode];
+  section = results;
+  if (!baselineTimes)
+    for (auto &result : section)
+      result.microseconds = 0;
+
+  auto &newSection = baseline["operator-new"];
+  newSection = section;
+  for (auto &result : newSection)
+    result.allocations = result.newAllocations;
+
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, sys::fs::F_Text);
+  if (ec) {
+    errs() << "error: cannot write baseline '" << path << "': "
+           << ec.message() << "\n";
+    return false;
+  }
+
+  os << "# Generated by tapi-benchmark -write-baseline. The times are only\n"
+        "# recorded with -baseline-times, because they depend on the machine.\n"
+        "# The allocation counts depend on how they were counted, so every\n"
+        "# counting mode has its own section. The operator-new section is\n"
+        "# recorded on every platform, and used when the platform's is missing.\n"
+        "#\n"
+        "# counting <glibc-malloc|malloc-zone|operator-new>\n"
+        "# name symbols allocs/iter [us/iter]\n";
+  for (const auto &entry : baseline) {
+    os << "counting " << entry.first << "\n";
+    for (const auto &result : entry.second) {
+      os << format("%s %zu %.1f", result.name.c_str(), result.symbols,
+                   result.allocations);
+      if (result.microseconds != 0)
+        os << format(" %.1f", result.microseconds);
+      os << "\n";
+    }
+  }
+  return true;
+}
+
+/// \brief Compare the results with the baseline and report the regressions.
+///
+/// The baseline of the current counting mode is used if there is one, and
+/// otherwise the operator new counts, which every platform can compare with.
+/// It is an error if there is neither. Benchmarks that are missing from the
+/// baseline are ignored. Any
+/// significant increase of the allocations fails, while the time may vary by
+/// the tolerance if the baseline records it.
+static bool checkBaseline(StringRef path) {
+  Baseline baseline;
+  if (!readBaseline(path, baseline))
+    return false;
+
+  bool compareNew = false;
+  auto section = baseline.find(countingMode);
+  if (section == baseline.end()) {
+    section = baseline.find("operator-new");
+    compareNew = true;
+  }
+  if (section == baseline.end()) {
+    errs() << "error: baseline '" << path << "' has no results counted with "
+           << countingMode << " or operator-new, and the counts of other "
+           << "modes are not comparable; record them with -write-baseline\n";
+    return false;
+  }
+
+  std::map<std::pair<std::string, size_t>, Result> expectations;
+  for (const auto &result : section->second)
+    expectations[std::make_pair(result.name, result.symbols)] = result;
+
+  bool success = true;
+  for (const auto &result : results) {
+    auto it = expectations.find(std::make_pair(result.name, result.symbols));
+    if (it == expectations.end())
+      continue;
+
+    const auto &expected = it->second;
+    if (expected.microseconds != 0 &&
+        result.microseconds > expected.microseconds * tolerance) {
+      errs() << format("regression: %s is %.1fx slower than the baseline "
+                       "(%.1f us/iter vs %.1f us/iter)\n",
+                       result.name.c_str(),
+                       result.microseconds / expected.microseconds,
+                       result.microseconds, expected.microseconds);
+      success = false;
+    }
+
+    // Allow for small differences between standard library implementations.
+    auto allocations =
+        compareNew ? result.newAllocations : result.allocations;
+    if (allocations > expected.allocations * 1.1 + 16) {
+      errs() << format("regression: %s allocates more than the baseline "
+                       "(%.1f allocs/iter vs %.1f allocs/iter)\n",
+                       result.name.c_str(), allocations,
+                       expected.allocations);
+      success = false;
+    }
+  }
+  return success;
+}
+
+/// \brief Check that a dylib and its text-based stubs have the same
+/// fingerprint as the interface file they were generated from.
+///
+/// The fingerprint is meant to be a cache key that doesn't depend on the file
+/// format, so any difference between the readers breaks it.
+static bool checkFingerprints(InterfaceFile &file, const Registry &readers) {
+  auto expected = file.getFingerprint();
+  auto check = [&](const std::string &content, StringRef path,
+                   StringRef format) {
+    auto result = readers.readFile(MemoryBufferRef(content, path));
+    if (!result || result->getErrorCode() ||
+        !isa<InterfaceFile>(result.get())) {
+      errs() << "error: cannot read the generated " << format << "\n";
+      return false;
+    }
+
+    auto fingerprint = cast<InterfaceFile>(result.get())->getFingerprint();
+    if (fingerprint == expected)
+      return true;
+
+    errs() << "error: the fingerprint of the " << format << " is "
+           << fingerprint.str() << ", but expected " << expected.str() << "\n";
+    return false;
+  };
+
+  bool success = check(generateDynamicLibrary(file), "Bench", "dylib");
+  success &= check(generateTextBasedStub(file, FileType::TBD_V1), "Bench.tbd",
+                   "text-based stub v1");
+  success &= check(generateTextBasedStub(file, FileType::TBD_V2), "Bench.tbd",
+                   "text-based stub v2");
+  return success;
+}
+
+static bool runBenchmarks(unsigned numSymbols) {
+  bool success = true;
+
+  CorpusOptions options;
+  options.numSymbols = numSymbols;
+  options.numLinkerDirectives = numSymbols / 100;
+  options.seed = seed;
+  auto file = generateInterfaceFile(options);
+  auto v1 = generateTextBasedStub(*file, FileType::TBD_V1);
+  auto v2 = generateTextBasedStub(*file, FileType::TBD_V2);
+  auto symbols = file->exports().size();
+
+  Registry readers;
+  readers.addYAMLReaders();
+  readers.addBinaryReaders();
+  auto readStub = [&readers](const std::string &content) {
+    auto file = readers.readFile(MemoryBufferRef(content, "Bench.tbd"));
+    return file && !file->getErrorCode();
+  };
+  success &= runBenchmark("read-v1", v1.size(), symbols,
+                          [&] { return readStub(v1); });
+  success &= runBenchmark("read-v2", v2.size(), symbols,
+                          [&] { return readStub(v2); });
+
+  // Disable the cache, otherwise only the first iteration parses the file.
+  tapi::LinkerInterfaceFile::setCacheCapacity(0);
+  struct CPU {
+    const char *name;
+    uint32_t type;
+    uint32_t subType;
+  };
+  static const CPU cpus[] = {
+      {"create-i386", MachO::CPU_TYPE_I386, MachO::CPU_SUBTYPE_I386_ALL},
+      {"create-x86_64", MachO::CPU_TYPE_X86_64, MachO::CPU_SUBTYPE_X86_64_ALL},
+      {"create-arm64", MachO::CPU_TYPE_ARM64, MachO::CPU_SUBTYPE_ARM64_ALL},
+  };
+  for (const auto &cpu : cpus) {
+    success &= runBenchmark(cpu.name, v2.size(), symbols, [&] {
+      std::string errorMessage;
+      std::unique_ptr<tapi::LinkerInterfaceFile> linkerFile(
+          tapi::LinkerInterfaceFile::create(
+              "Bench.tbd", reinterpret_cast<const uint8_t *>(v2.data()),
+              v2.size(), cpu.type, cpu.subType, tapi::ParsingFlags::None,
+              tapi::PackedVersion32(10, 9, 0), errorMessage));
+      return linkerFile != nullptr;
+    });
+  }
+
+  // Most of a flat namespace library are its undefined symbols, which don't
+  // need to be parsed if the caller doesn't use them.
+  auto flatOptions = options;
+  flatOptions.numUndefineds = numSymbols;
+  auto flatFile = generateInterfaceFile(flatOptions);
+  auto flat = generateTextBasedStub(*flatFile, FileType::TBD_V2);
+  auto flatSymbols = flatFile->exports().size() + flatFile->undefineds().size();
+  for (auto flags : {tapi::ParsingFlags::None,
+                     tapi::ParsingFlags::SkipUndefineds}) {
+    auto name = flags == tapi::ParsingFlags::None ? "create-flat"
+                                                  : "create-skip";
+    success &= runBenchmark(name, flat.size(), flatSymbols, [&] {
+      std::string errorMessage;
+      std::unique_ptr<tapi::LinkerInterfaceFile> linkerFile(
+          tapi::LinkerInterfaceFile::create(
+              "Flat.tbd", reinterpret_cast<const uint8_t *>(flat.data()),
+              flat.size(), MachO::CPU_TYPE_X86_64,
+              MachO::CPU_SUBTYPE_X86_64_ALL, flags,
+              tapi::PackedVersion32(10, 9, 0), errorMessage));
+      return linkerFile != nullptr;
+    });
+  }
+
+  // Create the files for all slices from one parse and materialize their
+  // exports, which projects the slices in one pass.
+  std::vector<tapi::CpuType> cpuTypes(std::end(cpus) - std::begin(cpus));
+  for (unsigned i = 0, e = cpuTypes.size(); i != e; ++i) {
+    cpuTypes[i].type = cpus[i].type;
+    cpuTypes[i].subType = cpus[i].subType;
+  }
+  success &= runBenchmark("create-slices", v2.size(), symbols, [&] {
+    auto results = tapi::LinkerInterfaceFile::createSlices(
+        "Bench.tbd", reinterpret_cast<const uint8_t *>(v2.data()), v2.size(),
+        cpuTypes, tapi::ParsingFlags::None, tapi::PackedVersion32(10, 9, 0));
+    bool success = true;
+    for (auto &result : results) {
+      std::unique_ptr<tapi::LinkerInterfaceFile> linkerFile(result.file);
+      success &= linkerFile != nullptr && !linkerFile->exports().empty();
+    }
+    return success;
+  });
+
+  auto readDylib = [&readers](const std::string &content) {
+    auto file = readers.readFile(MemoryBufferRef(content, "Bench"));
+    return file && !file->getErrorCode();
+  };
+  options.archs = ArchitectureSet(Arch::x86_64);
+  auto thinFile = generateInterfaceFile(options);
+  auto thin = generateDynamicLibrary(*thinFile);
+  success &= runBenchmark("macho-thin", thin.size(),
+                          thinFile->exports().size(),
+                          [&] { return readDylib(thin); });
+  options.archs = ArchitectureSet(Arch::x86_64 | Arch::x86_64h | Arch::arm64);
+  auto fatFile = generateInterfaceFile(options);
+  auto fat = generateDynamicLibrary(*fatFile);
+  success &= runBenchmark("macho-fat", fat.size(), fatFile->exports().size(),
+                          [&] { return readDylib(fat); });
+
+  // The dylib generator skips 32-bit architectures, so the check uses the
+  // universal dylib, which only has 64-bit ones.
+  success &= checkFingerprints(*fatFile, readers);
+  success &= runBenchmark("fingerprint", v2.size(), symbols, [&] {
+    return file->getFingerprint() != Fingerprint();
+  });
+
+  Registry writers;
+  writers.addYAMLWriters();
+  auto writeStub = [&](FileType type) {
+    file->setFileType(type);
+    raw_null_ostream os;
+    return !writers.writeFile(os, file.get());
+  };
+  success &= runBenchmark("write-v1", v1.size(), symbols,
+                          [&] { return writeStub(FileType::TBD_V1); });
+  success &= runBenchmark("write-v2", v2.size(), symbols,
+                          [&] { return writeStub(FileType::TBD_V2); });
+
+  return success;
+}
+
+int main(int argc, const char *argv[]) {
+  cl::ParseCommandLineOptions(argc, argv, "TAPI Benchmark Tool\n");
+  countAllocations();
+
+  if (symbolCounts.empty())
+    for (auto count : {1000U, 10000U, 100000U})
+      symbolCounts.push_back(count);
+
+  outs() << "benchmark                 symbols    iters      us/iter       MB/s"
+            "     Msym/s  allocs/iter    peak MB\n";
+
+  bool success = true;
+  if (scenarios) {
+    // Every iteration has to parse the file.
+    tapi::LinkerInterfaceFile::setCacheCapacity(0);
+    for (const auto &scenario : getScenarios())
+      success &= runScenario(scenario);
+  } else {
+    for (auto count : symbolCounts)
+      success &= runBenchmarks(count);
+  }
+
+  if (!writeBaselinePath.empty())
+    success &= writeBaseline(writeBaselinePath);
+  if (!baselinePath.empty())
+    success &= checkBaseline(baselinePath);
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}